@@ -13,46 +13,78 @@
 //   https://dennisbabkin.com/blog/?i=AAA12200
 //
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <random>
 #include "MyClass.h"
+#include "MyClassLoader.h"
+#include "MyClassPatch.h"
+#include "MyClassSnapshot.h"
+#include "utf.h"
+
+#include "golden.h"
 
 
 
 void fuzzer();
+bool selfTest(bool bCI);
+void printGolden();
 
 
 
-int main()
+int main(int argc, char* argv[])
 {
     //fuzzer();         //If we need to run a fuzzer
 
 
+    //Run the self-test, if requested as: BinSerialize -test [-ci]
+    //INFO: Returns non-zero exit code if any test failed, for use in scripts.
+    //      With -ci the speed baseline must already exist, instead of being saved on the first run.
+    //      It also only reports, instead of failing, if misaligned data is slower to de-serialize.
+    if(argc > 1 &&
+        strcmp(argv[1], "-test") == 0)
+    {
+        return selfTest(argc > 2 && strcmp(argv[2], "-ci") == 0) ? 0 : 1;
+    }
+
+
+    //Print golden fixtures for the self-test, if requested as: BinSerialize -golden > golden.h
+    //INFO: Only do it if the serialization format was changed on purpose!
+    if(argc > 1 &&
+        strcmp(argv[1], "-golden") == 0)
+    {
+        printGolden();
+        return 0;
+    }
+
+
     //Create some data to work with
     MyClass myClass;
 
     myClass.nYearEstablished = 2023;
     myClass.strName = "Class of 2023";
-    myClass.strNotes = "My super fictional class.";
+    myClass.setNotes("My super fictional class.");
 
     myClass.students.push_back(Student(21, AttendanceType::Enrolled, "John", "Doe"));
-    myClass.students.back().fPerformanceScore = 12.5;
-    myClass.students.back().strNotes = "Best student";
+    myClass.students.back().setPerformanceScore(12.5);
+    myClass.students.back().setNotes("Best student");
 
     myClass.students.push_back(Student(19, AttendanceType::Enrolling, "Mary", "Smith"));
-    myClass.students.back().fPerformanceScore = 13.75;
-    myClass.students.back().strNotes = "Will be attending in September";
+    myClass.students.back().setPerformanceScore(13.75);
+    myClass.students.back().setNotes("Will be attending in September");
 
     myClass.students.push_back(Student(76, AttendanceType::Graduated, "Kareem", "Abdul", "Jabbar"));
-    myClass.students.back().fPerformanceScore = 125.44;
+    myClass.students.back().setPerformanceScore(125.44);
 
     myClass.students.push_back(Student(35, AttendanceType::External, "Rihanna"));
-    myClass.students.back().strNotes = "Celebrity endorsement";
+    myClass.students.back().setNotes("Celebrity endorsement");
 
     myClass.students.push_back(Student(62, AttendanceType::DroppedOut, "Unruly Kid"));
-    myClass.students.back().fPerformanceScore = -5.0;
-    myClass.students.back().strNotes = "Never enroll him again!";
-    myClass.students.back().bSuspended = true;
+    myClass.students.back().setPerformanceScore(-5.0);
+    myClass.students.back().setNotes("Never enroll him again!");
+    myClass.students.back().setSuspended(true);
 
 
 
@@ -80,6 +112,164 @@ int main()
                 //All done
                 std::cout << "De-serialized OK!" << std::endl;
 
+
+                //Count enrolled students that are not suspended, without de-serializing them
+                size_t szCntEnrolled = 0;
+
+                if(MyClass::scanByteArray(pMem, szcbSize, 
+                    [](const StudentFixedFields& f)
+                    {
+                        return f.attendance == AttendanceType::Enrolled &&
+                            !f.bSuspended;
+                    }, 
+                    &szCntEnrolled) == szcbSize)
+                {
+                    std::cout << "Scanned OK, enrolled students: " << szCntEnrolled << std::endl;
+                }
+                else
+                    assert(false);
+
+
+                //Test columnar encoding
+                size_t szcbColumnar = myClass2.toByteArrayColumnar();
+                std::vector<uint8_t> columnar(szcbColumnar);
+
+                if(szcbColumnar != 0 &&
+                    myClass2.toByteArrayColumnar(columnar.data(), columnar.size()) == szcbColumnar)
+                {
+                    MyClass myClass3;
+
+                    if(myClass3.fromByteArrayColumnar(columnar.data(), columnar.size()) == szcbColumnar &&
+                        myClass3.toByteArray() == szcbSize)
+                    {
+                        std::cout << "Columnar round-trip OK, length of data: " << szcbColumnar << std::endl;
+                    }
+                    else
+                        assert(false);
+                }
+                else
+                    assert(false);
+
+
+                //Test dictionary encoding
+                size_t szcbDict = myClass2.toByteArrayDict();
+                std::vector<uint8_t> dict(szcbDict);
+
+                if(szcbDict != 0 &&
+                    myClass2.toByteArrayDict(dict.data(), dict.size()) == szcbDict)
+                {
+                    MyClass myClass3;
+
+                    if(myClass3.fromByteArrayDict(dict.data(), dict.size()) == szcbDict &&
+                        myClass3.toByteArray() == szcbSize)
+                    {
+                        std::cout << "Dictionary round-trip OK, length of data: " << szcbDict << std::endl;
+                    }
+                    else
+                        assert(false);
+                }
+                else
+                    assert(false);
+
+
+                //Test patch with a single changed score
+                MyClass myClass4 = myClass2;
+                myClass4.students[1].setPerformanceScore(14.0);
+
+                MyClassPatch patch = MyClassPatch::diff(myClass2, myClass4);
+
+                size_t szcbPatch = patch.toByteArray();
+                std::vector<uint8_t> patchData(szcbPatch);
+
+                if(szcbPatch != 0 &&
+                    patch.toByteArray(patchData.data(), patchData.size()) == szcbPatch)
+                {
+                    MyClassPatch patch2;
+                    MyClass myClass5 = myClass2;
+
+                    if(patch2.fromByteArray(patchData.data(), patchData.size()) == szcbPatch &&
+                        patch2.apply(myClass5) &&
+                        myClass5.students[1].getPerformanceScore() == 14.0)
+                    {
+                        std::cout << "Patch applied OK, length of data: " << szcbPatch << std::endl;
+                    }
+                    else
+                        assert(false);
+                }
+                else
+                    assert(false);
+
+
+                //Test checksum
+                size_t szcbCrc = myClass2.toByteArrayWithCrc();
+                std::vector<uint8_t> crcData(szcbCrc);
+
+                if(szcbCrc != 0 &&
+                    myClass2.toByteArrayWithCrc(crcData.data(), crcData.size()) == szcbCrc)
+                {
+                    MyClass myClass3;
+
+                    if(myClass3.fromByteArrayWithCrc(crcData.data(), crcData.size()) == szcbCrc)
+                    {
+                        //Corrupt one bit in the notes - it must be detected
+                        crcData[aligned(sizeof(size_t)) + szcbSize - aligned(myClass2.getNotesView().size())] ^= 0x1;
+
+                        if(myClass3.fromByteArrayWithCrc(crcData.data(), crcData.size()) == 0)
+                        {
+                            std::cout << "Checksum OK, length of data: " << szcbCrc << std::endl;
+                        }
+                        else
+                            assert(false);
+                    }
+                    else
+                        assert(false);
+                }
+                else
+                    assert(false);
+
+
+                //Test lazy de-serialization of notes
+                MyClass myClass6;
+
+                if(myClass6.fromByteArray(pMem, szcbSize, true) == szcbSize &&
+                    myClass6.toByteArray() == szcbSize &&
+                    myClass6.students[0].getNotes() == myClass.students[0].getNotesView())
+                {
+                    std::cout << "Lazy de-serialization OK" << std::endl;
+                }
+                else
+                    assert(false);
+
+
+                //Test limits
+                DecodeLimits limits;
+                limits.szMaxStudents = myClass.students.size() - 1;
+
+                if(myClass6.fromByteArray(pMem, szcbSize, false, &limits) == 0)
+                {
+                    std::cout << "Limits OK" << std::endl;
+                }
+                else
+                    assert(false);
+
+
+                //Test snapshot that is reloaded in the background
+                MyClassSnapshot snapshot;
+                snapshot.reloadAsync(std::vector<uint8_t>(pMem, pMem + szcbSize));
+                snapshot.waitForReloads();
+
+                {
+                    MyClassSnapshot::Reader reader = snapshot.read();
+
+                    if(reader &&
+                        reader->students.size() == myClass.students.size())
+                    {
+                        std::cout << "Snapshot OK" << std::endl;
+                    }
+                    else
+                        assert(false);
+                }
+
             }
             else
                 assert(false);
@@ -105,8 +295,10 @@ int main()
 
 
 
+#ifdef _WIN32
 #include <bcrypt.h>
 #pragma comment(lib, "bcrypt.lib")
+#endif
 
 
 /// <summary>
@@ -174,3 +366,1470 @@ void fuzzer()
 
 
 
+
+
+
+
+/// <summary>
+/// Serializes 'obj' with one of its toByteArray*() functions
+/// </summary>
+/// <param name="obj">Class to serialize</param>
+/// <param name="fnTo">Pointer to toByteArray*() function of the class</param>
+/// <returns>Serialized data, or empty if failed</returns>
+template<class T>
+static std::vector<uint8_t> serializeWith(const T& obj, size_t (T::*fnTo)(void*, size_t) const)
+{
+    std::vector<uint8_t> data((obj.*fnTo)(nullptr, 0));
+
+    if(data.empty() ||
+        (obj.*fnTo)(data.data(), data.size()) != data.size())
+    {
+        data.clear();
+    }
+
+    return data;
+}
+
+
+
+//Serialization formats of MyClass, and their golden fixtures
+static const struct
+{
+    const char* pStrName;                               //Name of the format
+    size_t (MyClass::*fnTo)(void*, size_t) const;       //Function that serializes in this format
+    size_t (*pfnFrom)(MyClass&, const void*, size_t);   //Function that de-serializes this format
+    const char* pStrArray;                              //Name of the array in golden.h
+    const uint8_t* pGolden;                             //Golden fixture
+    size_t szcbGolden;                                  //Size of 'pGolden' in bytes
+}
+kFormats[] = {
+    { "rows",       &MyClass::toByteArray,
+        [](MyClass& obj, const void* pData, size_t szcbData) { return obj.fromByteArray(pData, szcbData); },
+        "kGoldenRows",      kGoldenRows,        sizeof(kGoldenRows) },
+    { "columnar",   &MyClass::toByteArrayColumnar,
+        [](MyClass& obj, const void* pData, size_t szcbData) { return obj.fromByteArrayColumnar(pData, szcbData); },
+        "kGoldenColumnar",  kGoldenColumnar,    sizeof(kGoldenColumnar) },
+    { "dictionary", &MyClass::toByteArrayDict,
+        [](MyClass& obj, const void* pData, size_t szcbData) { return obj.fromByteArrayDict(pData, szcbData); },
+        "kGoldenDict",      kGoldenDict,        sizeof(kGoldenDict) },
+    { "crc",        &MyClass::toByteArrayWithCrc,
+        [](MyClass& obj, const void* pData, size_t szcbData) { return obj.fromByteArrayWithCrc(pData, szcbData); },
+        "kGoldenCrc",       kGoldenCrc,         sizeof(kGoldenCrc) },
+};
+
+
+
+/// <summary>
+/// Creates the class that is serialized into golden fixtures
+/// </summary>
+/// <returns>Class</returns>
+static MyClass makeGoldenClass()
+{
+    MyClass obj;
+    obj.nYearEstablished = MAX_ALLOWED_YEAR;
+    obj.strName = "Golden class";
+    obj.setNotes("Golden");
+
+    obj.students.push_back(Student(MIN_ALLOWED_AGE, AttendanceType::Enrolled, "John", "Smith"));
+    obj.students.back().setPerformanceScore(12.5);
+    obj.students.back().setNotes("Notes");
+
+    obj.students.push_back(Student(MAX_ALLOWED_AGE, AttendanceType::External, "John", "", "Smith"));
+    obj.students.back().setSuspended(true);
+
+    obj.students.push_back(Student(0, AttendanceType::Unknown, "Grace"));
+    obj.students.back().setPerformanceScore(-0.25);
+
+    return obj;
+}
+
+
+
+/// <summary>
+/// Prints golden fixtures for all formats as golden.h
+/// </summary>
+void printGolden()
+{
+    std::cout <<
+        "// This is a Proof-of-Concept (POC) project that demonstrates\n"
+        "// secure coding practices when programming binary\n"
+        "// serialization & de-serialization in C++.\n"
+        "//\n"
+        "// Copyright (c) 2023, by dennisbabkin.com\n"
+        "//\n"
+        "//\n"
+        "// This project is used in the following blog post:\n"
+        "//\n"
+        "//  \"Secure Programming Practices - Serialization\"\n"
+        "//  \"Example of secure binary serialization and de-serialization in C++.\"\n"
+        "//\n"
+        "//   https://dennisbabkin.com/blog/?i=AAA12200\n"
+        "//\n"
+        "\n"
+        "\n"
+        "//Golden fixtures for the self-test, made with: BinSerialize -golden > golden.h\n"
+        "//INFO: These are for 64-bit builds with 8-byte alignment\n"
+        "//\n"
+        "#pragma once\n"
+        "\n"
+        "#include <stdint.h>\n";
+
+    MyClass obj = makeGoldenClass();
+
+    for(const auto& g : kFormats)
+    {
+        std::vector<uint8_t> data = serializeWith(obj, g.fnTo);
+
+        std::cout << "\n\n\n//Format: " << g.pStrName << "\n"
+            "static const uint8_t " << g.pStrArray << "[] = {";
+
+        for(size_t i = 0; i < data.size(); i++)
+        {
+            char buff[8];
+            snprintf(buff, sizeof(buff), "0x%02x,", data[i]);
+
+            std::cout << (i % 16 == 0 ? "\n    " : " ") << buff;
+        }
+
+        std::cout << "\n};\n";
+    }
+}
+
+
+
+/// <summary>
+/// Prints bytes around the first difference between two byte arrays
+/// </summary>
+/// <param name="pStrName">Name of what is compared</param>
+/// <param name="expected">Expected bytes</param>
+/// <param name="actual">Actual bytes</param>
+static void printDiff(const char* pStrName, const std::vector<uint8_t>& expected, const std::vector<uint8_t>& actual)
+{
+    size_t szcbMin = std::min(expected.size(), actual.size());
+
+    size_t ofsDiff = 0;
+    while(ofsDiff < szcbMin &&
+        expected[ofsDiff] == actual[ofsDiff])
+    {
+        ofsDiff++;
+    }
+
+    std::cout << "Golden fixture mismatch for " << pStrName << ": expected " << expected.size() <<
+        " bytes, got " << actual.size() << ", first difference at offset " << ofsDiff << std::endl;
+
+    //Show 3 rows of 16 bytes, starting one row before the difference
+    size_t ofsStart = (ofsDiff & ~(size_t)0xF) >= 16 ? (ofsDiff & ~(size_t)0xF) - 16 : 0;
+
+    for(size_t ofsRow = ofsStart; ofsRow < ofsStart + 48 && ofsRow < std::max(expected.size(), actual.size()); ofsRow += 16)
+    {
+        for(const std::vector<uint8_t>* pData : { &expected, &actual })
+        {
+            char buff[32];
+            snprintf(buff, sizeof(buff), "%06zx %s", ofsRow, pData == &expected ? "exp" : "got");
+            std::cout << buff;
+
+            for(size_t i = ofsRow; i < ofsRow + 16; i++)
+            {
+                if(i < pData->size())
+                {
+                    snprintf(buff, sizeof(buff), "%c%02x", i == ofsDiff ? '>' : ' ', (*pData)[i]);
+                    std::cout << buff;
+                }
+                else
+                    std::cout << "   ";
+            }
+
+            std::cout << std::endl;
+        }
+    }
+}
+
+
+
+/// <summary>
+/// Creates a class with random data, including edge cases
+/// </summary>
+/// <param name="rng">Random number generator</param>
+/// <returns>Class</returns>
+static MyClass makeRandomClass(std::mt19937& rng)
+{
+    auto fnRandStr = [&rng](size_t szchMaxLen)
+    {
+        //Edge cases: empty and maximum length
+        std::string str;
+
+        switch(rng() % 4)
+        {
+            case 0:
+                break;
+
+            case 1:
+                str.assign(szchMaxLen, (char)('a' + rng() % 26));
+                break;
+
+            default:
+                str.resize(rng() % 20);
+                for(char& c : str)
+                {
+                    c = (char)(rng() % 256);
+                }
+                break;
+        }
+
+        return str;
+    };
+
+    MyClass obj;
+
+    static const int nYears[] = { 0, MIN_ALLOWED_YEAR, MAX_ALLOWED_YEAR, 2023 };
+    obj.nYearEstablished = nYears[rng() % std::size(nYears)];
+
+    obj.strName = fnRandStr(MAX_NAME_LEN_2);
+    if(obj.strName.empty())
+        obj.strName = "N";
+
+    obj.setNotes(fnRandStr(5000));
+
+    //Zero students is also an edge case
+    size_t szCntStudents = rng() % 4 == 0 ? 0 : rng() % 50;
+
+    for(size_t s = 0; s < szCntStudents; s++)
+    {
+        static const int nAges[] = { 0, MIN_ALLOWED_AGE, MAX_ALLOWED_AGE, 30 };
+
+        Student st;
+        st.setAge(nAges[rng() % std::size(nAges)]);
+
+        st.setGivenName(fnRandStr(MAX_NAME_LEN_1));
+        if(st.getGivenName().empty())
+            st.setGivenName("G");
+
+        st.setSecondName(fnRandStr(MAX_NAME_LEN_1));
+        st.setThirdName(fnRandStr(MAX_NAME_LEN_1));
+        st.setAttendance((AttendanceType)(rng() % (unsigned int)AttendanceType::MaxCount));
+        st.setSuspended(rng() % 2 != 0);
+        st.setPerformanceScore(rng() % 16 == 0 ? -0.0 : (double)(int)(rng() % 20000 - 10000) / 8.0);
+        st.setNotes(fnRandStr(3000));
+
+        obj.students.push_back(st);
+    }
+
+    return obj;
+}
+
+
+
+/// <summary>
+/// Function that tests all serialization formats, and the speed of de-serialization
+/// </summary>
+/// <param name="bCI">true to fail if there's no speed baseline file, false to save it on the first run. Also only reports slow misaligned de-serialization if true</param>
+/// <returns>true if all tests passed</returns>
+bool selfTest(bool bCI)
+{
+    //INFO: Don't use assert() here, since it is removed from the Release build
+    size_t szCntFailed = 0;
+
+    auto fnCheck = [&szCntFailed](bool bOK, const char* pStrWhat)
+    {
+        if(!bOK)
+        {
+            std::cout << "FAILED: " << pStrWhat << std::endl;
+            szCntFailed++;
+        }
+    };
+
+
+    //A string at the very end of the byte array without its alignment padding must fail, not overrun
+    {
+        std::string str = "abc";
+
+        std::vector<uint8_t> data(aligned_sizeof_str(str));
+        uint8_t* pD = data.data();
+        copy_aligned_str(pD, str);
+
+        const uint8_t* pS = data.data();
+        std::string strRead;
+        fnCheck(read_aligned_str(pS, data.data() + data.size(), strRead, 0) &&
+            strRead == str, "read_aligned_str");
+
+        pS = data.data();
+        fnCheck(!read_aligned_str(pS, data.data() + sizeof(size_t) + str.size(), strRead, 0), "read_aligned_str without padding");
+    }
+
+
+    //Container helpers must round-trip, and reject bad data without changing what they read into
+    {
+        std::vector<int32_t> vec = { 1, -2, 3 };
+        std::optional<double> opt = 2.5;
+        std::array<bool, 3> arr = { true, false, true };
+        std::map<std::string, uint16_t> map = { { "a", 1 }, { "bc", 2 }, { "def", 3 } };
+
+        std::vector<uint8_t> data(aligned_sizeof_vector(vec) + aligned_sizeof_optional(opt) +
+            aligned_sizeof_array<bool>(arr.size()) + aligned_sizeof_map(map));
+
+        uint8_t* pD = data.data();
+        copy_aligned_vector(pD, vec);
+        copy_aligned_optional(pD, opt);
+        copy_aligned_std_array(pD, arr);
+        copy_aligned_map(pD, map);
+        fnCheck(pD == data.data() + data.size(), "Container sizes");
+
+        const uint8_t* pEnd = data.data() + data.size();
+
+        std::vector<int32_t> vec2;
+        std::optional<double> opt2;
+        std::array<bool, 3> arr2 = {};
+        std::map<std::string, uint16_t> map2;
+
+        const uint8_t* pS = data.data();
+        fnCheck(read_aligned_vector(pS, pEnd, vec2) && vec2 == vec &&
+            read_aligned_optional(pS, pEnd, opt2) && opt2 == opt &&
+            read_aligned_std_array(pS, pEnd, arr2) && arr2 == arr &&
+            read_aligned_map(pS, pEnd, map2) && map2 == map &&
+            pS == pEnd, "Container round-trip");
+
+        //Empty optional
+        {
+            std::optional<double> optEmpty;
+            std::vector<uint8_t> dataOpt(aligned_sizeof_optional(optEmpty));
+            pD = dataOpt.data();
+            copy_aligned_optional(pD, optEmpty);
+
+            pS = dataOpt.data();
+            fnCheck(read_aligned_optional(pS, dataOpt.data() + dataOpt.size(), opt2) && !opt2, "read_aligned_optional empty");
+            opt2 = opt;
+        }
+
+        //Offsets of each container in 'data'
+        size_t ofsOpt = aligned_sizeof_vector(vec);
+        size_t ofsArr = ofsOpt + aligned_sizeof_optional(opt);
+        size_t ofsMap = ofsArr + aligned_sizeof_array<bool>(arr.size());
+
+        //Too many elements, failed validation and truncation
+        pS = data.data();
+        fnCheck(!read_aligned_vector(pS, pEnd, vec2, 2) && vec2 == vec, "read_aligned_vector szMaxCnt");
+
+        pS = data.data();
+        fnCheck(!read_aligned_vector(pS, pEnd, vec2, 0, [](const int32_t* pV, size_t szCnt) { return pV[szCnt - 1] != 3; }) &&
+            vec2 == vec, "read_aligned_vector validation");
+
+        pS = data.data();
+        fnCheck(!read_aligned_vector(pS, data.data() + ofsOpt - 1, vec2) && vec2 == vec, "read_aligned_vector truncated");
+
+        pS = data.data() + ofsMap;
+        fnCheck(!read_aligned_map(pS, pEnd, map2, 2) && map2 == map, "read_aligned_map szMaxCnt");
+
+        pS = data.data() + ofsMap;
+        fnCheck(!read_aligned_map(pS, pEnd, map2, 0, 2) && map2 == map, "read_aligned_map szchMaxLen");
+
+        pS = data.data() + ofsMap;
+        fnCheck(!read_aligned_map(pS, pEnd, map2, 0, 0, [](const std::string&, uint16_t v) { return v != 3; }) &&
+            map2 == map, "read_aligned_map validation");
+
+        pS = data.data() + ofsMap;
+        fnCheck(!read_aligned_map(pS, pEnd - 1, map2) && map2 == map, "read_aligned_map truncated");
+
+        //Bad values
+        std::vector<uint8_t> dataBad = data;
+        dataBad[ofsOpt] = 2;
+        pS = dataBad.data() + ofsOpt;
+        fnCheck(!read_aligned_optional(pS, dataBad.data() + dataBad.size(), opt2) && opt2 == opt, "read_aligned_optional bad flag");
+
+        dataBad = data;
+        dataBad[ofsArr + 1] = 2;
+        pS = dataBad.data() + ofsArr;
+        fnCheck(!read_aligned_std_array(pS, dataBad.data() + dataBad.size(), arr2) && arr2 == arr, "read_aligned_std_array bad bool");
+
+        //Keys out of order, or duplicates
+        std::map<uint32_t, uint32_t> mapOrder = { { 1, 10 }, { 2, 20 } };
+        std::vector<uint8_t> dataOrder(aligned_sizeof_map(mapOrder));
+        pD = dataOrder.data();
+        copy_aligned_map(pD, mapOrder);
+
+        std::map<uint32_t, uint32_t> mapOrder2 = mapOrder;
+
+        for(uint32_t nKey : { 0u, 1u })
+        {
+            //Second key goes after the count, the first key and its value
+            std::vector<uint8_t> dataKey = dataOrder;
+            memcpy(dataKey.data() + aligned(sizeof(size_t)) + 2 * aligned(sizeof(uint32_t)), &nKey, sizeof(nKey));
+
+            pS = dataKey.data();
+            fnCheck(!read_aligned_map(pS, dataKey.data() + dataKey.size(), mapOrder2) && mapOrder2 == mapOrder, "read_aligned_map key order");
+        }
+    }
+
+
+    //UTF-16 and UTF-8 conversions must round-trip, and reject what's not valid
+    {
+        std::mt19937 rng(16);
+
+        for(int t = 0; t < 1000; t++)
+        {
+            //Mix runs of ASCII characters (for the vectorized path) with everything else
+            std::u16string str16;
+            size_t szchLen = rng() % 64;
+
+            while(str16.size() < szchLen)
+            {
+                uint32_t cp;
+                switch(rng() % 4)
+                {
+                case 0: cp = 0x20 + rng() % 0x60; break;
+                case 1: cp = 0x80 + rng() % (0x800 - 0x80); break;
+                case 2: cp = 0x800 + rng() % (0x10000 - 0x800 - 0x800); if(cp >= 0xD800) cp += 0x800; break;
+                default: cp = 0x10000 + rng() % (0x110000 - 0x10000); break;
+                }
+
+                if(cp < 0x10000)
+                {
+                    str16 += (char16_t)cp;
+                }
+                else
+                {
+                    str16 += (char16_t)(0xD800 + ((cp - 0x10000) >> 10));
+                    str16 += (char16_t)(0xDC00 + ((cp - 0x10000) & 0x3FF));
+                }
+            }
+
+            std::string str8;
+            std::u16string str16Back;
+            fnCheck(utf16_to_utf8(str16.data(), str16.size(), str8) &&
+                utf8_to_utf16(str8.data(), str8.size(), str16Back) &&
+                str16Back == str16, "UTF round-trip");
+        }
+
+        //Known encodings, after ASCII characters that are converted at once
+        std::string strPrefix(16, 'a');
+        std::u16string str16Prefix(16, u'a');
+
+        std::string str8;
+        std::u16string str16;
+        fnCheck(utf16_to_utf8((str16Prefix + u"\u00E9\u20AC\xD83D\xDE00").data(), str16Prefix.size() + 4, str8) &&
+            str8 == strPrefix + "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80", "utf16_to_utf8");
+
+        fnCheck(utf8_to_utf16((strPrefix + "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80").data(), strPrefix.size() + 9, str16) &&
+            str16 == str16Prefix + u"\u00E9\u20AC\xD83D\xDE00", "utf8_to_utf16");
+
+        //Lone surrogates
+        static const std::u16string strBad16[] = {
+            u"\xD83D",                         //High surrogate at the end
+            u"\xD83D" u"a",                    //High surrogate without a low one
+            u"\xD83D\xD83D",                   //Two high surrogates
+            u"\xDE00",                         //Low surrogate first
+        };
+
+        for(const std::u16string& strBad : strBad16)
+        {
+            for(const std::u16string& strPre : { std::u16string(), str16Prefix })
+            {
+                std::u16string strIn = strPre + strBad;
+                fnCheck(!utf16_to_utf8(strIn.data(), strIn.size(), str8), "utf16_to_utf8 lone surrogate");
+            }
+        }
+
+        //Overlong forms, truncated sequences, bad bytes, encoded surrogates and code points out of range
+        static const char* pStrBad8[] = {
+            "\xC0\x80", "\xC1\xBF", "\xE0\x80\x80", "\xE0\x9F\xBF", "\xF0\x80\x80\x80", "\xF0\x8F\xBF\xBF",
+            "\xC3", "\xE2\x82", "\xF0\x9F\x98",
+            "\x80", "\xBF", "\xF8\x88\x80\x80\x80", "\xFF", "\xC3\x41", "\xE2\x28\xAC",
+            "\xED\xA0\x80", "\xED\xBF\xBF",
+            "\xF4\x90\x80\x80", "\xF7\xBF\xBF\xBF",
+        };
+
+        for(const char* pStrBad : pStrBad8)
+        {
+            for(const std::string& strPre : { std::string(), strPrefix })
+            {
+                std::string strIn = strPre + pStrBad;
+                fnCheck(!utf8_to_utf16(strIn.data(), strIn.size(), str16), "utf8_to_utf16 not valid");
+            }
+        }
+
+        //Read directly from serialized UTF-16
+        std::u16string str16Ser = str16Prefix + u"\u20AC";
+        std::vector<uint8_t> data(aligned_sizeof_str(str16Ser));
+        uint8_t* pD = data.data();
+        copy_aligned_str(pD, str16Ser);
+
+        const uint8_t* pEnd = data.data() + data.size();
+        const uint8_t* pS = data.data();
+        fnCheck(read_aligned_str_utf16_as_utf8(pS, pEnd, str8, 0) &&
+            str8 == strPrefix + "\xE2\x82\xAC" &&
+            pS == pEnd, "read_aligned_str_utf16_as_utf8");
+
+        pS = data.data();
+        fnCheck(!read_aligned_str_utf16_as_utf8(pS, pEnd, str8, str16Ser.size() - 1), "read_aligned_str_utf16_as_utf8 szchMaxLen");
+
+        //Budget is charged for the worst case, since that much is allocated
+        DecodeLimits limits;
+        limits.szcbMaxStrings = str16Ser.size() * 3;
+
+        DecodeBudget budget;
+        budget.pLimits = &limits;
+
+        pS = data.data();
+        fnCheck(read_aligned_str_utf16_as_utf8(pS, pEnd, str8, 0, &budget) &&
+            budget.szcbStrings == limits.szcbMaxStrings, "read_aligned_str_utf16_as_utf8 budget");
+
+        budget = DecodeBudget();
+        budget.pLimits = &limits;
+        limits.szcbMaxStrings--;
+
+        pS = data.data();
+        fnCheck(!read_aligned_str_utf16_as_utf8(pS, pEnd, str8, 0, &budget) &&
+            pS == data.data(), "read_aligned_str_utf16_as_utf8 over budget");
+    }
+
+
+    //Fixed-size columns of the columnar encoding must be rejected for any invalid value, and all SIMD kernels
+    //that can run on this CPU must find the same first invalid value as the scalar code, also in the partial vectors at the end
+    {
+        using FN_FIND = size_t (*)(const uint8_t* pCol, size_t szCnt);
+
+        std::vector<FN_FIND> fnsAge = {
+            [](const uint8_t* pCol, size_t szCnt) { return simd_find_int32_out_of_range_or_zero_scalar(pCol, szCnt, MIN_ALLOWED_AGE, MAX_ALLOWED_AGE); },
+#ifdef SIMD_SSE2
+            [](const uint8_t* pCol, size_t szCnt) { return simd_find_int32_out_of_range_or_zero_sse2(pCol, szCnt, MIN_ALLOWED_AGE, MAX_ALLOWED_AGE); },
+#endif
+        };
+
+        std::vector<FN_FIND> fnsAttendance = {
+            [](const uint8_t* pCol, size_t szCnt) { return simd_find_uint32_not_below_scalar(pCol, szCnt, (uint32_t)AttendanceType::MaxCount); },
+#ifdef SIMD_SSE2
+            [](const uint8_t* pCol, size_t szCnt) { return simd_find_uint32_not_below_sse2(pCol, szCnt, (uint32_t)AttendanceType::MaxCount); },
+#endif
+        };
+
+        std::vector<FN_FIND> fnsScore = {
+            [](const uint8_t* pCol, size_t szCnt) { return simd_find_nonfinite_double_scalar(pCol, szCnt); },
+#ifdef SIMD_SSE2
+            [](const uint8_t* pCol, size_t szCnt) { return simd_find_nonfinite_double_sse2(pCol, szCnt); },
+#endif
+        };
+
+#ifdef SIMD_X86
+        if(simd_has_avx2())
+        {
+            fnsAge.push_back([](const uint8_t* pCol, size_t szCnt) { return simd_find_int32_out_of_range_or_zero_avx2(pCol, szCnt, MIN_ALLOWED_AGE, MAX_ALLOWED_AGE); });
+            fnsAttendance.push_back([](const uint8_t* pCol, size_t szCnt) { return simd_find_uint32_not_below_avx2(pCol, szCnt, (uint32_t)AttendanceType::MaxCount); });
+            fnsScore.push_back([](const uint8_t* pCol, size_t szCnt) { return simd_find_nonfinite_double_avx2(pCol, szCnt); });
+        }
+#endif
+
+        const std::vector<int32_t> badAges = { MAX_ALLOWED_AGE + 1, MIN_ALLOWED_AGE - 1, -1, INT32_MIN };
+        const std::vector<uint32_t> badAttendances = { (uint32_t)AttendanceType::MaxCount, 0xFFFFFFFF };
+        const std::vector<double> badScores = { NAN, INFINITY, -INFINITY };
+
+        MyClass obj;
+        obj.nYearEstablished = 2023;
+        obj.strName = "Columns";
+
+        //Offset of a fixed-size column: 0 = ages, 1 = attendance, 2 = suspended bitmap, 3 = scores
+        auto fnColumnOffset = [&obj](size_t szCnt, int nColumn)
+        {
+            size_t ofs = aligned(sizeof(obj.nYearEstablished)) + aligned_sizeof_str(obj.strName) + aligned(sizeof(size_t));
+
+            if(nColumn > 0)
+                ofs += aligned_sizeof_array<int>(szCnt);
+            if(nColumn > 1)
+                ofs += aligned_sizeof_array<AttendanceType>(szCnt);
+            if(nColumn > 2)
+                ofs += aligned_sizeof_array<uint8_t>((szCnt + 7) / 8);
+
+            return ofs;
+        };
+
+        //Plants each bad value at each index of a column
+        auto fnTestColumn = [&](const char* pStrName, const std::vector<uint8_t>& data, size_t szCnt, int nColumn,
+            const auto& badValues, const std::vector<FN_FIND>& fns)
+        {
+            size_t ofsColumn = fnColumnOffset(szCnt, nColumn);
+
+            for(FN_FIND fn : fns)
+            {
+                fnCheck(fn(data.data() + ofsColumn, szCnt) == szCnt, pStrName);
+            }
+
+            for(size_t i = 0; i < szCnt; i++)
+            {
+                for(const auto& bad : badValues)
+                {
+                    std::vector<uint8_t> dataBad = data;
+                    memcpy(dataBad.data() + ofsColumn + i * sizeof(bad), &bad, sizeof(bad));
+
+                    for(FN_FIND fn : fns)
+                    {
+                        fnCheck(fn(dataBad.data() + ofsColumn, szCnt) == i, pStrName);
+                    }
+
+                    MyClass objBad;
+                    fnCheck(objBad.fromByteArrayColumnar(dataBad.data(), dataBad.size()) == 0, pStrName);
+                }
+            }
+        };
+
+        for(size_t szCnt = 0; szCnt <= 40; szCnt++)
+        {
+            std::vector<uint8_t> data = serializeWith(obj, &MyClass::toByteArrayColumnar);
+
+            MyClass obj2;
+            fnCheck(obj2.fromByteArrayColumnar(data.data(), data.size()) == data.size(), "fromByteArrayColumnar");
+
+            fnTestColumn("columnar age", data, szCnt, 0, badAges, fnsAge);
+            fnTestColumn("columnar attendance", data, szCnt, 1, badAttendances, fnsAttendance);
+            fnTestColumn("columnar score", data, szCnt, 3, badScores, fnsScore);
+
+            //Unused bits at the end of the suspended bitmap must be 0
+            if(szCnt % 8 != 0)
+            {
+                size_t ofsLast = fnColumnOffset(szCnt, 2) + szCnt / 8;
+
+                for(size_t b = szCnt % 8; b < 8; b++)
+                {
+                    std::vector<uint8_t> dataBad = data;
+                    dataBad[ofsLast] |= (uint8_t)(1 << b);
+
+                    fnCheck(obj2.fromByteArrayColumnar(dataBad.data(), dataBad.size()) == 0, "columnar suspended padding");
+                }
+
+                //The last used bit is fine
+                std::vector<uint8_t> dataSuspended = data;
+                dataSuspended[ofsLast] |= (uint8_t)(1 << (szCnt % 8 - 1));
+
+                fnCheck(obj2.fromByteArrayColumnar(dataSuspended.data(), dataSuspended.size()) == dataSuspended.size() &&
+                    obj2.students.back().isSuspended(), "columnar suspended");
+            }
+
+            obj.students.push_back(Student(MIN_ALLOWED_AGE + (int)szCnt, AttendanceType::Enrolled, "S"));
+            obj.students.back().setPerformanceScore((double)szCnt);
+        }
+    }
+
+
+    //Any corruption of data with a checksum must be detected, and leave the class empty
+    {
+        std::vector<uint8_t> data = serializeWith(makeGoldenClass(), &MyClass::toByteArrayWithCrc);
+        std::vector<uint8_t> dataRows = serializeWith(makeGoldenClass(), &MyClass::toByteArray);
+
+        auto fnCheckRejected = [&](const std::vector<uint8_t>& dataBad, const char* pStrWhat)
+        {
+            MyClass obj = makeGoldenClass();
+
+            fnCheck(obj.fromByteArrayWithCrc(dataBad.data(), dataBad.size()) == 0 &&
+                obj.nYearEstablished == 0 &&
+                obj.strName.empty() &&
+                obj.getNotesView().empty() &&
+                obj.students.empty(), pStrWhat);
+        };
+
+        MyClass obj;
+        fnCheck(obj.fromByteArrayWithCrc(data.data(), data.size()) == data.size() &&
+            serializeWith(obj, &MyClass::toByteArray) == dataRows, "fromByteArrayWithCrc");
+
+        for(size_t b = 0; b < data.size() * 8; b++)
+        {
+            std::vector<uint8_t> dataBad = data;
+            dataBad[b / 8] ^= (uint8_t)(1 << (b % 8));
+
+            fnCheckRejected(dataBad, "fromByteArrayWithCrc bit flip");
+        }
+
+        //Length of the class data that is shorter or longer than it is
+        for(size_t szcbClass : { (size_t)0, dataRows.size() - 1, dataRows.size() + 1, data.size(), SIZE_MAX })
+        {
+            std::vector<uint8_t> dataBad = data;
+            memcpy(dataBad.data(), &szcbClass, sizeof(szcbClass));
+
+            fnCheckRejected(dataBad, "fromByteArrayWithCrc bad length");
+        }
+
+        //Checksum of some other data
+        {
+            std::vector<uint8_t> dataBad = data;
+            uint32_t nCrc = crc32c(dataRows.data(), dataRows.size() - 1);
+            memcpy(dataBad.data() + aligned(sizeof(size_t)) + dataRows.size(), &nCrc, sizeof(nCrc));
+
+            fnCheckRejected(dataBad, "fromByteArrayWithCrc wrong crc");
+        }
+
+        for(size_t szcb = 0; szcb < data.size(); szcb++)
+        {
+            fnCheckRejected(std::vector<uint8_t>(data.begin(), data.begin() + szcb), "fromByteArrayWithCrc truncated");
+        }
+
+        //All implementations of CRC32C must agree, for any length and alignment
+        std::mt19937 rng(32);
+
+        for(size_t szcb = 0; szcb <= 64; szcb++)
+        {
+            for(int t = 0; t < 8; t++)
+            {
+                std::vector<uint8_t> buff(szcb + 8);
+                for(uint8_t& v : buff)
+                {
+                    v = (uint8_t)rng();
+                }
+
+                const uint8_t* p = buff.data() + rng() % 8;
+                uint32_t nCrcStart = t == 0 ? 0 : (uint32_t)rng();
+                uint32_t nCrc = crc32c_scalar(p, szcb, nCrcStart);
+
+#ifdef SIMD_X86
+                if(simd_has_sse42())
+                {
+                    fnCheck(crc32c_sse42(p, szcb, nCrcStart) == nCrc, "crc32c_sse42");
+                }
+#endif
+
+                //CRC of a part continues with the rest
+                size_t szcbPart = szcb ? rng() % szcb : 0;
+                fnCheck(crc32c(p + szcbPart, szcb - szcbPart, crc32c(p, szcbPart, nCrcStart)) == nCrc, "crc32c in parts");
+            }
+        }
+
+        //Known value for "123456789"
+        fnCheck(crc32c_scalar("123456789", 9) == 0xE3069283 &&
+            crc32c("123456789", 9) == 0xE3069283, "crc32c check value");
+    }
+
+
+    //Patches must reproduce the target exactly, and bad patches must not change it
+    {
+        MyClass objFrom;
+        objFrom.nYearEstablished = 2023;
+        objFrom.strName = "Patch";
+
+        objFrom.students.push_back(Student(20, AttendanceType::Enrolled, "John"));
+        objFrom.students.push_back(Student(30, AttendanceType::Enrolled, "Mary"));
+
+        //Sign of zero is serialized, so it must be patched too
+        MyClass objTo = objFrom;
+        objTo.students[0].setPerformanceScore(-0.0);
+
+        MyClassPatch patch = MyClassPatch::diff(objFrom, objTo);
+
+        MyClass obj = objFrom;
+        fnCheck(patch.students.size() == 1 &&
+            patch.apply(obj) &&
+            std::signbit(obj.students[0].getPerformanceScore()) &&
+            serializeWith(obj, &MyClass::toByteArray) == serializeWith(objTo, &MyClass::toByteArray), "MyClassPatch -0.0");
+
+        //Change one student and add another one
+        objTo.students[1].setAge(31);
+        objTo.students.push_back(Student(40, AttendanceType::Graduated, "Kim"));
+
+        MyClassPatch patchGood = MyClassPatch::diff(objFrom, objTo);
+
+        obj = objFrom;
+        fnCheck(patchGood.students.size() == 3 &&
+            patchGood.apply(obj) &&
+            serializeWith(obj, &MyClass::toByteArray) == serializeWith(objTo, &MyClass::toByteArray), "MyClassPatch apply");
+
+        if(patchGood.students.size() == 3)
+        {
+            std::vector<uint8_t> dataFrom = serializeWith(objFrom, &MyClass::toByteArray);
+
+            auto fnCheckRejected = [&](const MyClassPatch& patchBad, const char* pStrWhat)
+            {
+                MyClass objBad = objFrom;
+                fnCheck(!patchBad.apply(objBad) &&
+                    serializeWith(objBad, &MyClass::toByteArray) == dataFrom, pStrWhat);
+            };
+
+            patch = patchGood;
+            std::swap(patch.students[0], patch.students[1]);
+            fnCheckRejected(patch, "MyClassPatch indexes out of order");
+
+            patch = patchGood;
+            patch.students[1].szIndex = patch.students[0].szIndex;
+            fnCheckRejected(patch, "MyClassPatch duplicate index");
+
+            patch = patchGood;
+            patch.students[2].dwFields = SPF_AGE;
+            fnCheckRejected(patch, "MyClassPatch new student without SPF_ALL");
+
+            patch = patchGood;
+            patch.students.pop_back();
+            fnCheckRejected(patch, "MyClassPatch new student missing");
+
+            patch = patchGood;
+            patch.szCntStudents = 2;
+            fnCheckRejected(patch, "MyClassPatch index out of range");
+
+            patch = patchGood;
+            patch.dwFields |= MPF_YEAR_ESTABLISHED;
+            patch.nYearEstablished = MAX_ALLOWED_YEAR + 1;
+            fnCheckRejected(patch, "MyClassPatch bad year");
+
+            patch = patchGood;
+            patch.dwFields |= MPF_NAME;
+            patch.strName.clear();
+            fnCheckRejected(patch, "MyClassPatch empty name");
+
+            patch = patchGood;
+            patch.students[1].st.setAge(MAX_ALLOWED_AGE + 1);
+            fnCheckRejected(patch, "MyClassPatch bad age");
+
+            patch = patchGood;
+            patch.students[1].dwFields |= 0x100;
+            fnCheckRejected(patch, "MyClassPatch unknown field");
+        }
+    }
+
+
+    //Dictionary encoding must not expand into unlimited amount of strings
+    {
+        MyClass obj;
+        obj.strName = "Bomb";
+
+        std::string strLong(MAX_NAME_LEN_1, 'B');
+
+        for(int s = 0; s < 1000; s++)
+        {
+            obj.students.push_back(Student(20, AttendanceType::Enrolled, strLong.c_str(), strLong.c_str(), strLong.c_str()));
+        }
+
+        std::vector<uint8_t> data = serializeWith(obj, &MyClass::toByteArrayDict);
+
+        MyClass obj2;
+        fnCheck(obj2.fromByteArrayDict(data.data(), data.size()) == 0, "fromByteArrayDict default expansion limit");
+
+        DecodeLimits limits;
+        limits.szcbMaxStrings = 4 * 1024 * 1024;
+        fnCheck(obj2.fromByteArrayDict(data.data(), data.size(), &limits) == data.size(), "fromByteArrayDict with limits");
+
+        limits.szcbMaxStrings = 1024 * 1024;
+        fnCheck(obj2.fromByteArrayDict(data.data(), data.size(), &limits) == 0, "fromByteArrayDict over limits");
+    }
+
+
+    //Round-trip random classes in all formats
+    std::mt19937 rng(12200);
+
+    for(int i = 0; i < 500; i++)
+    {
+        MyClass obj = makeRandomClass(rng);
+
+        std::vector<uint8_t> data = serializeWith(obj, &MyClass::toByteArray);
+        fnCheck(!data.empty(), "toByteArray");
+
+        MyClass obj2;
+        fnCheck(obj2.fromByteArray(data.data(), data.size()) == data.size() &&
+            serializeWith(obj2, &MyClass::toByteArray) == data, "fromByteArray round-trip");
+
+        MyClass obj3;
+        fnCheck(obj3.fromByteArray(data.data(), data.size(), true) == data.size() &&
+            serializeWith(obj3, &MyClass::toByteArray) == data, "fromByteArray lazy round-trip");
+
+        //Copies of a lazily de-serialized class must not depend on the original byte array,
+        //and notes that were set after lazy de-serialization must be the ones that are used
+        {
+            std::vector<uint8_t> dataLazy = data;
+
+            MyClass objLazy;
+            fnCheck(objLazy.fromByteArray(dataLazy.data(), dataLazy.size(), true) == dataLazy.size(), "fromByteArray lazy");
+
+            MyClass objCopy = objLazy;
+            dataLazy.assign(dataLazy.size(), 0xCC);
+
+            fnCheck(serializeWith(objCopy, &MyClass::toByteArray) == data, "copy of lazily de-serialized class");
+
+            objLazy.setNotes("NEW class");
+            if(!objLazy.students.empty())
+            {
+                objLazy.students[0].setNotes("NEW notes");
+            }
+
+            std::vector<uint8_t> dataNew = serializeWith(objLazy, &MyClass::toByteArray);
+
+            MyClass objNew;
+            fnCheck(objNew.fromByteArray(dataNew.data(), dataNew.size()) == dataNew.size() &&
+                objNew.getNotesView() == "NEW class" &&
+                (objNew.students.empty() || objNew.students[0].getNotesView() == "NEW notes"), "notes set after lazy de-serialization");
+        }
+
+        std::vector<uint8_t> dataCol = serializeWith(obj, &MyClass::toByteArrayColumnar);
+        MyClass obj4;
+        fnCheck(obj4.fromByteArrayColumnar(dataCol.data(), dataCol.size()) == dataCol.size() &&
+            serializeWith(obj4, &MyClass::toByteArray) == data, "fromByteArrayColumnar round-trip");
+
+        std::vector<uint8_t> dataDict = serializeWith(obj, &MyClass::toByteArrayDict);
+        MyClass obj5;
+        fnCheck(obj5.fromByteArrayDict(dataDict.data(), dataDict.size()) == dataDict.size() &&
+            serializeWith(obj5, &MyClass::toByteArray) == data, "fromByteArrayDict round-trip");
+
+        std::vector<uint8_t> dataCrc = serializeWith(obj, &MyClass::toByteArrayWithCrc);
+        MyClass obj6;
+        fnCheck(obj6.fromByteArrayWithCrc(dataCrc.data(), dataCrc.size()) == dataCrc.size() &&
+            serializeWith(obj6, &MyClass::toByteArray) == data, "fromByteArrayWithCrc round-trip");
+
+        //Patch between two random classes, sent as a byte array
+        MyClass objOther = makeRandomClass(rng);
+        std::vector<uint8_t> dataPatch = serializeWith(MyClassPatch::diff(objOther, obj), &MyClassPatch::toByteArray);
+
+        MyClassPatch patch;
+        MyClass obj7 = objOther;
+        fnCheck(patch.fromByteArray(dataPatch.data(), dataPatch.size()) == dataPatch.size() &&
+            patch.apply(obj7) &&
+            serializeWith(obj7, &MyClass::toByteArray) == data, "MyClassPatch round-trip");
+
+        //Cached students must serialize the same, until they are changed
+        MyClass obj8 = obj;
+        fnCheck(obj8.cacheStudents() &&
+            serializeWith(obj8, &MyClass::toByteArray) == data, "cached students");
+
+        if(!obj8.students.empty())
+        {
+            //Any setter must drop the cached bytes, so that all formats see the change
+            Student& st = obj8.students[rng() % obj8.students.size()];
+
+            switch(rng() % 8)
+            {
+                case 0: st.setAge(st.getAge() == 0 ? MIN_ALLOWED_AGE : 0); break;
+                case 1: st.setGivenName(st.getGivenName() == "G" ? "H" : "G"); break;
+                case 2: st.setSecondName(st.getSecondName().empty() ? "S" : ""); break;
+                case 3: st.setThirdName(st.getThirdName().empty() ? "T" : ""); break;
+                case 4: st.setAttendance(st.getAttendance() == AttendanceType::Enrolled ? AttendanceType::Unknown : AttendanceType::Enrolled); break;
+                case 5: st.setSuspended(!st.isSuspended()); break;
+                case 6: st.setPerformanceScore(st.getPerformanceScore() + 1.0); break;
+                default: st.setNotes(st.getNotesView().empty() ? "N" : ""); break;
+            }
+
+            fnCheck(!st.isCached(), "setter drops cached bytes");
+
+            std::vector<uint8_t> dataChanged = serializeWith(obj8, &MyClass::toByteArray);
+            fnCheck(!dataChanged.empty() &&
+                dataChanged != data, "cached students after change");
+
+            for(const auto& f : kFormats)
+            {
+                std::vector<uint8_t> dataF = serializeWith(obj8, f.fnTo);
+
+                MyClass obj9;
+                fnCheck(f.pfnFrom(obj9, dataF.data(), dataF.size()) == dataF.size() &&
+                    serializeWith(obj9, &MyClass::toByteArray) == dataChanged, f.pStrName);
+            }
+
+            MyClass obj9 = obj;
+            fnCheck(MyClassPatch::diff(obj, obj8).apply(obj9) &&
+                serializeWith(obj9, &MyClass::toByteArray) == dataChanged, "MyClassPatch after change");
+        }
+
+        //All formats must respect the limits
+        if(obj.students.size() > 1)
+        {
+            DecodeLimits limits;
+            limits.szMaxStudents = obj.students.size() - 1;
+
+            fnCheck(obj2.fromByteArray(data.data(), data.size(), false, &limits) == 0 &&
+                obj2.fromByteArrayColumnar(dataCol.data(), dataCol.size(), &limits) == 0 &&
+                obj2.fromByteArrayDict(dataDict.data(), dataDict.size(), &limits) == 0 &&
+                obj2.fromByteArrayWithCrc(dataCrc.data(), dataCrc.size(), &limits) == 0, "szMaxStudents");
+
+            std::vector<uint8_t> dataPatch = serializeWith(MyClassPatch::diff(MyClass(), obj), &MyClassPatch::toByteArray);
+
+            MyClassPatch patch;
+            fnCheck(patch.fromByteArray(dataPatch.data(), dataPatch.size(), &limits) == 0 &&
+                patch.fromByteArray(dataPatch.data(), dataPatch.size()) == dataPatch.size(), "MyClassPatch szMaxStudents");
+
+            //Allow exactly what the data needs
+            MyClass objNames;
+            fnCheck(objNames.fromByteArray(data.data(), data.size()) == data.size(), "fromByteArray");
+
+            size_t szcbStrings = objNames.strName.size() + objNames.getNotesView().size();
+            for(const Student& st : objNames.students)
+            {
+                szcbStrings += st.getGivenName().size() + st.getSecondName().size() + st.getThirdName().size() + st.getNotesView().size();
+            }
+
+            limits = DecodeLimits();
+            limits.szcbMaxStrings = szcbStrings;
+
+            fnCheck(obj2.fromByteArray(data.data(), data.size(), false, &limits) == data.size() &&
+                obj2.fromByteArrayColumnar(dataCol.data(), dataCol.size(), &limits) == dataCol.size(), "szcbMaxStrings");
+
+            //Dictionary also counts its table, that is never larger than the names in it
+            limits.szcbMaxStrings = szcbStrings * 2;
+            fnCheck(obj2.fromByteArrayDict(dataDict.data(), dataDict.size(), &limits) == dataDict.size(), "fromByteArrayDict szcbMaxStrings");
+
+            limits.szcbMaxStrings = szcbStrings - 1;
+
+            if(szcbStrings > 0)
+            {
+                fnCheck(obj2.fromByteArray(data.data(), data.size(), false, &limits) == 0 &&
+                    obj2.fromByteArrayColumnar(dataCol.data(), dataCol.size(), &limits) == 0 &&
+                    obj2.fromByteArrayDict(dataDict.data(), dataDict.size(), &limits) == 0, "szcbMaxStrings exceeded");
+            }
+        }
+
+        //Truncated data must fail
+        if(data.size() > 1)
+        {
+            fnCheck(obj2.fromByteArray(data.data(), data.size() - 1) == 0, "fromByteArray truncated");
+        }
+
+        //Scan must match the same students as the de-serialized class
+        {
+            auto fnPredicate = [](const StudentFixedFields& f)
+            {
+                return (f.attendance == AttendanceType::Enrolled && !f.bSuspended) ||
+                    (f.nAge % 3 == 0 && f.fPerformanceScore >= 50.0);
+            };
+
+            size_t szCntExpected = 0;
+
+            for(const Student& st : obj.students)
+            {
+                StudentFixedFields f;
+                f.nAge = st.getAge();
+                f.attendance = st.getAttendance();
+                f.bSuspended = st.isSuspended();
+                f.fPerformanceScore = st.getPerformanceScore();
+
+                if(fnPredicate(f))
+                    szCntExpected++;
+            }
+
+            size_t szCntMatched = (size_t)-1;
+            fnCheck(MyClass::scanByteArray(data.data(), data.size(), fnPredicate, &szCntMatched) == data.size() &&
+                szCntMatched == szCntExpected, "scanByteArray count");
+
+            //Scan must reject exactly what de-serialization rejects
+            auto fnCheckSame = [&](const std::vector<uint8_t>& dataBad, const char* pStrWhat)
+            {
+                MyClass objBad;
+                fnCheck(MyClass::scanByteArray(dataBad.data(), dataBad.size(), fnPredicate) ==
+                    objBad.fromByteArray(dataBad.data(), dataBad.size()), pStrWhat);
+            };
+
+            for(int t = 0; t < 8; t++)
+            {
+                size_t szcb = rng() % data.size();
+                fnCheckSame(std::vector<uint8_t>(data.begin(), data.begin() + szcb), "scanByteArray truncated");
+            }
+
+            for(int t = 0; t < 16; t++)
+            {
+                std::vector<uint8_t> dataBad = data;
+                dataBad[rng() % dataBad.size()] ^= (uint8_t)(1 << (rng() % 8));
+                dataBad[rng() % dataBad.size()] = (uint8_t)rng();
+
+                fnCheckSame(dataBad, "scanByteArray corrupted");
+            }
+        }
+    }
+
+
+    //Compare with golden fixtures byte by byte - these are for 64-bit builds with 8-byte alignment
+    if constexpr(sizeof(void*) == 8)
+    {
+        MyClass obj = makeGoldenClass();
+
+        for(const auto& g : kFormats)
+        {
+            std::vector<uint8_t> data = serializeWith(obj, g.fnTo);
+            std::vector<uint8_t> golden(g.pGolden, g.pGolden + g.szcbGolden);
+
+            if(data != golden)
+            {
+                printDiff(g.pStrName, golden, data);
+                fnCheck(false, "golden fixture");
+            }
+
+            //Golden fixture must also be read back into the same class
+            MyClass obj2;
+            fnCheck(g.pfnFrom(obj2, golden.data(), golden.size()) == golden.size() &&
+                serializeWith(obj2, g.fnTo) == golden, "golden fixture read");
+        }
+    }
+
+
+    //Load good, bad and missing files with MyClassLoader
+    {
+        std::error_code ec;
+        std::filesystem::path pathDir = std::filesystem::temp_directory_path(ec) / "BinSerialize_selftest";
+        std::filesystem::create_directories(pathDir, ec);
+
+        auto fnWriteFile = [](const std::filesystem::path& path, const std::vector<uint8_t>& data)
+        {
+            std::ofstream file(path, std::ios::binary);
+            file.write((const char*)data.data(), data.size());
+        };
+
+        std::vector<std::filesystem::path> paths;
+        std::vector<std::vector<uint8_t>> datas;
+        std::vector<size_t> countsStudents;
+
+        for(int f = 0; f < 16; f++)
+        {
+            MyClass obj = makeRandomClass(rng);
+            std::vector<uint8_t> data = serializeWith(obj, &MyClass::toByteArray);
+
+            paths.push_back(pathDir / ("good" + std::to_string(f) + ".bin"));
+            datas.push_back(data);
+            countsStudents.push_back(obj.students.size());
+
+            fnWriteFile(paths.back(), data);
+        }
+
+        //Bad data, empty file, and a file that doesn't exist
+        paths.push_back(pathDir / "bad.bin");
+        fnWriteFile(paths.back(), std::vector<uint8_t>(100, 0xCC));
+
+        paths.push_back(pathDir / "empty.bin");
+        fnWriteFile(paths.back(), std::vector<uint8_t>());
+
+        paths.push_back(pathDir / "missing.bin");
+
+        {
+            MyClassLoader loader(paths, 2, 4);
+
+            size_t szCntLoaded = 0;
+            size_t szCntGood = 0;
+            LoadedMyClass result;
+
+            while(loader.getNext(result))
+            {
+                szCntLoaded++;
+
+                std::string strName = result.path.filename().string();
+
+                if(strName.rfind("good", 0) == 0)
+                {
+                    size_t f = (size_t)std::stoi(strName.substr(4));
+
+                    fnCheck(result.bSuccess &&
+                        serializeWith(result.obj, &MyClass::toByteArray) == datas[f], "MyClassLoader good file");
+
+                    szCntGood++;
+                }
+                else
+                {
+                    fnCheck(!result.bSuccess, "MyClassLoader bad file");
+                }
+            }
+
+            fnCheck(szCntLoaded == paths.size() &&
+                szCntGood == datas.size(), "MyClassLoader count");
+        }
+
+        //Limits must be passed to de-serialization
+        {
+            //Half of the good files must fail
+            std::vector<size_t> counts = countsStudents;
+            std::sort(counts.begin(), counts.end());
+
+            DecodeLimits limits;
+            limits.szMaxStudents = std::max(counts[counts.size() / 2], (size_t)1);
+
+            MyClassLoader loader(paths, 2, 4, 256 * 1024 * 1024, &limits);
+
+            size_t szCntLoaded = 0;
+            LoadedMyClass result;
+
+            while(loader.getNext(result))
+            {
+                szCntLoaded++;
+
+                std::string strName = result.path.filename().string();
+
+                if(strName.rfind("good", 0) == 0)
+                {
+                    size_t f = (size_t)std::stoi(strName.substr(4));
+
+                    fnCheck(result.bSuccess == (countsStudents[f] <= limits.szMaxStudents), "MyClassLoader limits");
+                }
+            }
+
+            fnCheck(szCntLoaded == paths.size(), "MyClassLoader count with limits");
+        }
+
+        //Destroying the loader before all results were taken must not hang
+        {
+            MyClassLoader loader(paths, 1, 4);
+
+            LoadedMyClass result;
+            fnCheck(loader.getNext(result), "MyClassLoader early destruction");
+        }
+
+        std::filesystem::remove_all(pathDir, ec);
+    }
+
+
+    //Many readers use snapshots while they are replaced in the background
+    {
+        //Version 'v' of the class has it in the year, and (v % 8 + 1) students of the same age - so that readers can check it
+        auto fnMakeVersion = [](int v)
+        {
+            MyClass obj;
+            obj.nYearEstablished = MIN_ALLOWED_YEAR + v;
+            obj.strName = "Snapshot";
+
+            for(int s = 0; s < v % 8 + 1; s++)
+            {
+                obj.students.push_back(Student(MIN_ALLOWED_AGE + v % 8, AttendanceType::Enrolled, "S"));
+            }
+
+            return serializeWith(obj, &MyClass::toByteArray);
+        };
+
+        //Waits for replaced snapshots to be deleted, without calling publish()
+        auto fnWaitForRetired = [](MyClassSnapshot& snapshot)
+        {
+            for(int t = 0; t < 200 && snapshot.getCountRetired() != 0; t++)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+
+            return snapshot.getCountRetired() == 0;
+        };
+
+        const int kCntReaders = 6;
+        const int kCntReloads = 1000;
+
+        MyClassSnapshot snapshot(kCntReaders);
+
+        std::atomic<bool> bStop = false;
+        std::atomic<size_t> szCntBad = 0;
+        std::atomic<size_t> szCntRead = 0;
+
+        std::vector<std::thread> readers;
+
+        for(int r = 0; r < kCntReaders; r++)
+        {
+            readers.emplace_back([&]()
+            {
+                int nYearPrev = 0;
+
+                while(!bStop.load())
+                {
+                    MyClassSnapshot::Reader reader = snapshot.read();
+                    if(!reader)
+                        continue;
+
+                    //Versions can only go up
+                    int v = reader->nYearEstablished - MIN_ALLOWED_YEAR;
+                    bool bOK = reader->nYearEstablished >= nYearPrev &&
+                        reader->students.size() == (size_t)(v % 8 + 1);
+
+                    for(const Student& st : reader->students)
+                    {
+                        if(st.getAge() != MIN_ALLOWED_AGE + v % 8)
+                            bOK = false;
+                    }
+
+                    if(!bOK)
+                        szCntBad++;
+
+                    szCntRead++;
+                    nYearPrev = reader->nYearEstablished;
+                }
+            });
+        }
+
+        for(int v = 0; v < kCntReloads; v++)
+        {
+            snapshot.reloadAsync(fnMakeVersion(v));
+
+            //Let some of them be replaced before they start, and others not
+            if(v % 4 == 0)
+                snapshot.waitForReloads();
+        }
+
+        snapshot.waitForReloads();
+
+        bStop = true;
+
+        for(std::thread& thread : readers)
+        {
+            thread.join();
+        }
+
+        fnCheck(szCntBad == 0 &&
+            szCntRead > 0, "MyClassSnapshot readers");
+
+        {
+            MyClassSnapshot::Reader reader = snapshot.read();
+            fnCheck(reader &&
+                reader->nYearEstablished == MIN_ALLOWED_YEAR + kCntReloads - 1 &&
+                snapshot.getCountFailedReloads() == 0, "MyClassSnapshot last version");
+        }
+
+        fnCheck(fnWaitForRetired(snapshot), "MyClassSnapshot retired after readers");
+
+        //Bad data must keep the current snapshot
+        std::vector<uint8_t> dataBad(100, 0xCC);
+
+        snapshot.reloadAsync(dataBad);
+        snapshot.waitForReloads();
+
+        fnCheck(!snapshot.reload(dataBad.data(), dataBad.size()) &&
+            snapshot.getCountFailedReloads() == 1, "MyClassSnapshot failed reload");
+
+        {
+            MyClassSnapshot::Reader reader = snapshot.read();
+            fnCheck(reader &&
+                reader->nYearEstablished == MIN_ALLOWED_YEAR + kCntReloads - 1, "MyClassSnapshot kept after failed reload");
+
+            //Snapshot that is replaced while in use stays valid, until the reader is done with it
+            fnCheck(snapshot.reload(fnMakeVersion(1).data(), fnMakeVersion(1).size()) &&
+                snapshot.getCountRetired() == 1 &&
+                reader->nYearEstablished == MIN_ALLOWED_YEAR + kCntReloads - 1, "MyClassSnapshot replaced while in use");
+        }
+
+        //It must be deleted even if nothing else is published
+        fnCheck(fnWaitForRetired(snapshot), "MyClassSnapshot retired without publish");
+    }
+
+
+    //Measure speed of de-serialization, and compare it with the saved baseline
+    {
+        MyClass obj;
+        obj.nYearEstablished = 2023;
+        obj.strName = "Benchmark";
+
+        for(int s = 0; s < 10000; s++)
+        {
+            obj.students.push_back(Student(20 + s % 50, AttendanceType::Enrolled, "John", "Smith"));
+            obj.students.back().setNotes("Some notes about the student");
+        }
+
+        std::vector<uint8_t> data = serializeWith(obj, &MyClass::toByteArray);
+
+        //Speed in MB/s of the best of several short samples, so that a single
+        //interruption by the OS doesn't look like a slowdown
+        auto fnBestMBps = [](size_t szcbData, auto fnRun)
+        {
+            const int kCntSamples = 5;
+            double fBestMBps = 0;
+
+            for(int s = 0; s < kCntSamples; s++)
+            {
+                size_t szCntIterations = 0;
+
+                auto tmStart = std::chrono::steady_clock::now();
+                auto tmElapsed = tmStart - tmStart;
+
+                do
+                {
+                    fnRun();
+
+                    szCntIterations++;
+                    tmElapsed = std::chrono::steady_clock::now() - tmStart;
+                }
+                while(tmElapsed < std::chrono::milliseconds(100));
+
+                double fMBps = (double)szcbData * szCntIterations / (1024.0 * 1024.0) /
+                    std::chrono::duration<double>(tmElapsed).count();
+
+                fBestMBps = std::max(fBestMBps, fMBps);
+            }
+
+            return fBestMBps;
+        };
+
+        auto fnMeasure = [&fnCheck, &fnBestMBps](const uint8_t* pData, size_t szcbData)
+        {
+            MyClass obj2;
+
+            return fnBestMBps(szcbData, [&]()
+            {
+                fnCheck(obj2.fromByteArray(pData, szcbData) == szcbData, "benchmark fromByteArray");
+            });
+        };
+
+        double fMBps = fnMeasure(data.data(), data.size());
+
+        std::cout << "De-serialization speed: " << fMBps << " MB/s" << std::endl;
+
+        //The caller may pass data at any offset - make sure that it doesn't slow us down
+        std::vector<uint8_t> dataMisaligned(data.size() + 1);
+        memcpy(dataMisaligned.data() + 1, data.data(), data.size());
+
+        //Allow for measurement noise. Shared CI machines are too noisy for this to fail there, so only report it
+        const double kMaxMisalignedSlowdown = 0.25;
+
+        double fMBpsAligned = fMBps;
+        double fMBpsMisaligned = fnMeasure(dataMisaligned.data() + 1, data.size());
+
+        //CPU speed drifts during the run, and a real slowdown shows every time - so if it looks
+        //slow, measure both again, one right after the other
+        for(int r = 0; r < 3 && fMBpsMisaligned < fMBpsAligned * (1.0 - kMaxMisalignedSlowdown); r++)
+        {
+            fMBpsAligned = fnMeasure(data.data(), data.size());
+            fMBpsMisaligned = fnMeasure(dataMisaligned.data() + 1, data.size());
+        }
+
+        std::cout << "De-serialization speed (misaligned): " << fMBpsMisaligned << " MB/s" << std::endl;
+
+        if(fMBpsMisaligned < fMBpsAligned * (1.0 - kMaxMisalignedSlowdown))
+        {
+            if(bCI)
+            {
+                std::cout << "WARNING: misaligned de-serialization is slower by more than " <<
+                    kMaxMisalignedSlowdown * 100 << "%" << std::endl;
+            }
+            else
+            {
+                fnCheck(false, "misaligned de-serialization speed");
+            }
+        }
+
+        //Serialization of students that didn't change only copies their cached bytes
+        auto fnMeasureTo = [&obj, &data, &fnBestMBps]()
+        {
+            return fnBestMBps(data.size(), [&]()
+            {
+                obj.toByteArray(data.data(), data.size());
+            });
+        };
+
+        std::cout << "Serialization speed: " << fnMeasureTo() << " MB/s" << std::endl;
+
+        fnCheck(obj.cacheStudents(), "benchmark cacheStudents");
+        std::cout << "Serialization speed (cached): " << fnMeasureTo() << " MB/s" << std::endl;
+
+        //Fail if we're slower than the saved baseline by this fraction
+        const double kMaxSlowdown = 0.25;
+        const char* pStrBaselineFile = "BinSerialize.perf";
+
+        double fBaselineMBps = 0;
+        std::ifstream fileIn(pStrBaselineFile);
+
+        if(fileIn >> fBaselineMBps)
+        {
+            std::cout << "Baseline speed: " << fBaselineMBps << " MB/s" << std::endl;
+
+            fnCheck(fMBps >= fBaselineMBps * (1.0 - kMaxSlowdown), "de-serialization speed regression");
+        }
+        else if(bCI)
+        {
+            //Baseline must be made on the same machine before, by running without -ci
+            std::cout << "No baseline in: " << pStrBaselineFile << std::endl;
+
+            fnCheck(false, "de-serialization speed baseline");
+        }
+        else
+        {
+            //No baseline yet - save this one
+            std::ofstream fileOut(pStrBaselineFile);
+            fileOut << fMBps << std::endl;
+
+            std::cout << "Saved baseline to: " << pStrBaselineFile << std::endl;
+        }
+    }
+
+
+    if(szCntFailed)
+    {
+        std::cout << "Self-test FAILED: " << szCntFailed << " check(s)" << std::endl;
+        return false;
+    }
+
+    std::cout << "Self-test passed" << std::endl;
+    return true;
+}
+
+
+
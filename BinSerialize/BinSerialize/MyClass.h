@@ -19,15 +19,21 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "student.h"
+#include "crc32c.h"
 
 
 
 
 struct MyClass
 {
+    //Names copied out of the table by fromByteArrayDict() may take at most this many times the size of its byte array, if no limits were given
+    static constexpr size_t DICT_MAX_EXPANSION = 16;
+
     //Year the class was established, 0 if unknown
     //[MIN_ALLOWED_YEAR - MAX_ALLOWED_YEAR] acceptable range
     int nYearEstablished = 0;
@@ -39,10 +45,67 @@ struct MyClass
     //People associated with a class
     std::vector<Student> students;
 
-    //Internal notes about the class
-    std::string strNotes;
+private:
+
+    //Internal notes about the class - use getNotes(), getNotesView() and setNotes()
+    //INFO: It refers to the original byte array, if it was de-serialized lazily
+    LazyOrOwnedStr strNotes;
+
+public:
+
+
+
+
+
+    /// <summary>
+    /// Returns 'strNotes', and copies it out of the original byte array, if it was de-serialized lazily
+    /// </summary>
+    /// <returns>Notes about the class</returns>
+    const std::string& getNotes()
+    {
+        return strNotes.get();
+    }
+
+
+    /// <summary>
+    /// Returns 'strNotes' without copying it, even if it was de-serialized lazily
+    /// </summary>
+    /// <returns>View of the notes, valid until this struct is modified</returns>
+    std::string_view getNotesView() const
+    {
+        return strNotes.view();
+    }
+
+
+    /// <summary>
+    /// Sets 'strNotes', and drops the reference to the original byte array, if it was de-serialized lazily
+    /// </summary>
+    /// <param name="notes">New notes</param>
+    void setNotes(std::string_view notes)
+    {
+        strNotes.set(notes);
+    }
+
+
 
+    /// <summary>
+    /// Checks if 'nYearEstablished' value is within the acceptable range
+    /// </summary>
+    /// <param name="nYear">Year to check</param>
+    /// <returns>true if valid</returns>
+    static bool isValidYear(int nYear)
+    {
+        if(nYear != 0)
+        {
+            if(nYear < MIN_ALLOWED_YEAR ||
+                nYear > MAX_ALLOWED_YEAR)
+            {
+                return false;
+            }
+        }
 
+        return true;
+    }
 
 
 
@@ -51,9 +114,15 @@ struct MyClass
     /// </summary>
     /// <param name="pData">Byte array to convert</param>
     /// <param name="szcbData">Size of 'pData' in bytes</param>
+    /// <param name="bLazyNotes">true to only check 'strNotes' of the class and of all students for bounds, and keep references to them in 'pData' instead of copying them,
+    ///                          in that case 'pData' must remain valid until getNotes() is called, or this struct is modified</param>
+    /// <param name="pLimits">if not 0, limits on resources used by this call, that are checked before any memory is allocated</param>
     /// <returns>[1 and up) if success, for amount of bytes used, 0 if error - in this case this struct will be reset</returns>
-    size_t fromByteArray(const void* pData, size_t szcbData)
+    size_t fromByteArray(const void* pData, size_t szcbData, bool bLazyNotes = false, const DecodeLimits* pLimits = nullptr)
     {
+        DecodeBudget budget;
+        budget.pLimits = pLimits;
+
         while(true)
         {
             //Do we have a pointer to data?
@@ -73,16 +142,12 @@ struct MyClass
             if(!read_aligned(pS, pEnd, nYearEstablished))
                 break;
 
-            if(nYearEstablished != 0)
-            {
-                if(nYearEstablished < MIN_ALLOWED_YEAR ||
-                    nYearEstablished > MAX_ALLOWED_YEAR)
-                    break;
-            }
+            if(!isValidYear(nYearEstablished))
+                break;
             
 
             //Check 'strName'
-            if(!read_aligned_str(pS, pEnd, strName, MAX_NAME_LEN_2))
+            if(!read_aligned_str(pS, pEnd, strName, MAX_NAME_LEN_2, &budget))
                 break;
 
             if(strName.empty())
@@ -97,6 +162,15 @@ struct MyClass
             if((intptr_t)szCntStudents < 0)
                 break;
 
+            if(pLimits &&
+                pLimits->szMaxStudents > 0 &&
+                szCntStudents > pLimits->szMaxStudents)
+                break;
+
+            //Each student takes at least this much, so the count can't be more than what fits in what's left
+            if(szCntStudents > (size_t)(pEnd - pS) / Student::getMinByteArraySize())
+                break;
+
 /*
 
 size_t cnt_students
@@ -112,11 +186,17 @@ student_data[]
             bool bReadStudentsOK = true;
             students.clear();
 
+            //The count was checked above, so it's safe to allocate all at once
+            if(!budget.addAllocation(szCntStudents * sizeof(Student)))
+                break;
+
+            students.reserve(szCntStudents);
+
             Student st;
 
             for(size_t s = 0; s < szCntStudents; s++)
             {
-                size_t szcb = st.fromByteArray(pS, pEnd - pS);
+                size_t szcb = st.fromByteArray(pS, pEnd - pS, bLazyNotes, &budget);
                 if(!szcb)
                 {
                     //Failed
@@ -126,7 +206,8 @@ student_data[]
                 }
 
                 //Add student to the list
-                students.push_back(st);
+                //INFO: Move it, since a copy would also copy out notes that were de-serialized lazily
+                students.push_back(std::move(st));
 
                 pS += szcb;
             }
@@ -136,8 +217,19 @@ student_data[]
 
 
             //Check 'strNotes'
-            if(!read_aligned_str(pS, pEnd, strNotes, 0))
-                break;
+            if(bLazyNotes)
+            {
+                LazyStr lzNotes;
+                if(!read_aligned_str_lazy(pS, pEnd, lzNotes, 0))
+                    break;
+
+                strNotes.setLazy(lzNotes);
+            }
+            else
+            {
+                if(!read_aligned_str(pS, pEnd, strNotes.owned(), 0, &budget))
+                    break;
+            }
 
 
 
@@ -157,7 +249,7 @@ student_data[]
                 __fastfail(FAST_FAIL_FATAL_APP_EXIT);
 #else
                 //General case
-                abort(-1);
+                abort();
 #endif
             }
 
@@ -178,6 +270,149 @@ student_data[]
 
 
 
+    /// <summary>
+    /// Scans serialized byte array of this struct without materializing it. Each student
+    /// record is validated and its fixed-size fields are passed to 'fnPredicate', while
+    /// string payloads are skipped over by their lengths.
+    /// </summary>
+    /// <param name="pData">Byte array to scan</param>
+    /// <param name="szcbData">Size of 'pData' in bytes</param>
+    /// <param name="fnPredicate">Callback invoked for each student as: bool(const StudentFixedFields&amp;), it should return true to count the student as a match</param>
+    /// <param name="pszCntMatched">if not 0, receives the number of students for which 'fnPredicate' returned true</param>
+    /// <returns>[1 and up) if success, for amount of bytes used, 0 if error</returns>
+    template<class PRED>
+    static size_t scanByteArray(const void* pData, size_t szcbData, PRED fnPredicate, size_t* pszCntMatched = nullptr)
+    {
+        while(true)
+        {
+            //Do we have a pointer to data?
+            if(!pData)
+                break;
+
+            //Check overall data size provided
+            if((intptr_t)szcbData <= 0)
+                break;
+
+            const uint8_t* pS = (const uint8_t*)pData;
+            const uint8_t* pEnd = pS + szcbData;
+            assert(pEnd > pS);
+
+
+            //Check 'nYearEstablished'
+            int nYear;
+            if(!read_aligned(pS, pEnd, nYear))
+                break;
+
+            if(!isValidYear(nYear))
+                break;
+
+
+            //Check 'strName'
+            size_t szchName;
+            if(!skip_aligned_str(pS, pEnd, MAX_NAME_LEN_2, &szchName))
+                break;
+
+            if(szchName == 0)
+                break;
+
+
+            //Check 'students'
+            size_t szCntStudents;
+            if(!read_aligned(pS, pEnd, szCntStudents))
+                break;
+
+            if((intptr_t)szCntStudents < 0)
+                break;
+
+            bool bReadStudentsOK = true;
+            size_t szCntMatched = 0;
+
+            StudentFixedFields fields;
+
+            for(size_t s = 0; s < szCntStudents; s++)
+            {
+                size_t szcb = Student::scanByteArray(pS, pEnd - pS, fields);
+                if(!szcb)
+                {
+                    //Failed
+                    bReadStudentsOK = false;
+
+                    break;
+                }
+
+                if(fnPredicate(fields))
+                {
+                    szCntMatched++;
+                }
+
+                pS += szcb;
+            }
+
+            if(!bReadStudentsOK)
+                break;
+
+
+            //Check 'strNotes'
+            if(!skip_aligned_str(pS, pEnd, 0))
+                break;
+
+
+
+            //Sanity check
+            if(pS <= pEnd)
+            {
+                //Success!
+                if(pszCntMatched)
+                {
+                    *pszCntMatched = szCntMatched;
+                }
+
+                return pS - (const uint8_t*)pData;
+            }
+            else
+            {
+                //Overflow
+                assert(false);
+
+#ifdef _WIN32
+                //Microsoft specific code
+                __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                //General case
+                abort();
+#endif
+            }
+
+
+            break;
+        }
+
+        //Failed
+        return 0;
+    }
+
+
+
+
+
+
+    /// <summary>
+    /// Keeps serialized bytes of all students, so that toByteArray() only needs to copy them - see Student::cache()
+    /// </summary>
+    /// <returns>true if success</returns>
+    bool cacheStudents()
+    {
+        for(Student& st : students)
+        {
+            if(!st.cache())
+                return false;
+        }
+
+        return true;
+    }
+
+
+
     /// <summary>
     /// Serializes this struct by converting it to a byte array
     /// </summary>
@@ -193,7 +428,7 @@ student_data[]
             aligned(sizeof(nYearEstablished)) +
             aligned_sizeof_str(strName) +
             aligned(sizeof(size_t)) +               //Count of elements in the 'students' array
-            aligned_sizeof_str(strNotes);
+            aligned_sizeof_str(getNotesView());
 
         std::vector<Student>::const_iterator itr = students.begin();
         const std::vector<Student>::const_iterator itrEnd = students.end();
@@ -237,7 +472,7 @@ student_data[]
                         __fastfail(FAST_FAIL_FATAL_APP_EXIT);
 #else
                         //General case
-                        abort(-1);
+                        abort();
 #endif
                     }
 
@@ -245,11 +480,11 @@ student_data[]
                 }
                 
                 //Add notes
-                copy_aligned_str(pD, strNotes);
+                copy_aligned_str(pD, getNotesView());
 
 
                 //Sanity check
-                if(pD - (uint8_t*)pBuff == szcbData)
+                if((size_t)(pD - (uint8_t*)pBuff) == szcbData)
                 {
                     //All done!
                     szcbRet = szcbData;
@@ -264,7 +499,7 @@ student_data[]
                     __fastfail(FAST_FAIL_FATAL_APP_EXIT);
 #else
                     //General case
-                    abort(-1);
+                    abort();
 #endif
                 }
             }
@@ -281,5 +516,1003 @@ student_data[]
     }
 
 
-};
 
+
+    /// <summary>
+    /// Serializes this struct by converting it to a byte array, using columnar encoding for the 'students' array.
+    /// In it each field of all students is stored together in its own column, which compresses better
+    /// and allows to validate each column in a single loop. Use fromByteArrayColumnar() to read it back.
+    /// </summary>
+    /// <param name="pBuff">if not 0, pointer to the buffer to fill out</param>
+    /// <param name="szcbBuff">Size of provided 'pBuff' in bytes</param>
+    /// <returns>Size of the filled (or needed to fill) buffer in bytes, or 0 if error</returns>
+    size_t toByteArrayColumnar(void* pBuff = nullptr, size_t szcbBuff = 0) const
+    {
+/*
+
+int nYearEstablished
+string strName
+size_t cnt_students
+int nAge[cnt_students]
+AttendanceType attendance[cnt_students]
+uint8_t bSuspended[(cnt_students + 7) / 8]      <- bitmap
+double fPerformanceScore[cnt_students]
+for each string field: strGivenName, strSecondName, strThirdName, strNotes
+    size_t end_offset[cnt_students]             <- in characters, from the start of chars[]
+    char chars[end_offset[cnt_students - 1]]
+string strNotes
+
+*/
+        size_t szcbRet = 0;
+
+        size_t szCntStudents = students.size();
+
+        //Determine the size needed
+        size_t szcbData = 
+            aligned(sizeof(nYearEstablished)) +
+            aligned_sizeof_str(strName) +
+            aligned(sizeof(size_t)) +               //Count of elements in the 'students' array
+            aligned_sizeof_array<int>(szCntStudents) +
+            aligned_sizeof_array<AttendanceType>(szCntStudents) +
+            aligned_sizeof_array<uint8_t>((szCntStudents + 7) / 8) +
+            aligned_sizeof_array<double>(szCntStudents) +
+            aligned_sizeof_str(getNotesView());
+
+        for(const ColumnStr& col : kColumnStrs)
+        {
+            size_t szchTotal = 0;
+
+            for(const Student& st : students)
+            {
+                szchTotal += col.pfnGet(st).size();
+            }
+
+            szcbData += aligned_sizeof_array<size_t>(szCntStudents) +
+                aligned_sizeof_array<char>(szchTotal);
+        }
+
+        //Was the buffer provided?
+        if(pBuff)
+        {
+            //Compare the size provided
+            if(szcbBuff >= szcbData)
+            {
+                //Fill out the buffer
+                uint8_t* pD = (uint8_t*)pBuff;
+
+                //Clear provided buffer
+                memset(pD, 0, szcbData);
+
+                copy_aligned(pD, nYearEstablished);
+
+                copy_aligned_str(pD, strName);
+
+                copy_aligned(pD, szCntStudents);
+
+                //Fixed-size columns
+                for(size_t s = 0; s < szCntStudents; s++)
+                {
+                    memcpy(pD + s * sizeof(int), &students[s].nAge, sizeof(int));
+                }
+                pD += aligned_sizeof_array<int>(szCntStudents);
+
+                for(size_t s = 0; s < szCntStudents; s++)
+                {
+                    memcpy(pD + s * sizeof(AttendanceType), &students[s].attendance, sizeof(AttendanceType));
+                }
+                pD += aligned_sizeof_array<AttendanceType>(szCntStudents);
+
+                for(size_t s = 0; s < szCntStudents; s++)
+                {
+                    //Buffer was cleared above, so only set bits
+                    if(students[s].bSuspended)
+                    {
+                        pD[s / 8] |= (uint8_t)(1 << (s % 8));
+                    }
+                }
+                pD += aligned_sizeof_array<uint8_t>((szCntStudents + 7) / 8);
+
+                for(size_t s = 0; s < szCntStudents; s++)
+                {
+                    memcpy(pD + s * sizeof(double), &students[s].fPerformanceScore, sizeof(double));
+                }
+                pD += aligned_sizeof_array<double>(szCntStudents);
+
+                //String columns
+                for(const ColumnStr& col : kColumnStrs)
+                {
+                    uint8_t* pOffsets = pD;
+                    pD += aligned_sizeof_array<size_t>(szCntStudents);
+
+                    size_t szchOffset = 0;
+
+                    for(size_t s = 0; s < szCntStudents; s++)
+                    {
+                        std::string_view str = col.pfnGet(students[s]);
+
+                        memcpy(pD + szchOffset * sizeof(char), str.data(), str.size() * sizeof(char));
+                        szchOffset += str.size();
+
+                        memcpy(pOffsets + s * sizeof(size_t), &szchOffset, sizeof(size_t));
+                    }
+
+                    pD += aligned_sizeof_array<char>(szchOffset);
+                }
+
+                //Add notes
+                copy_aligned_str(pD, getNotesView());
+
+
+                //Sanity check
+                if((size_t)(pD - (uint8_t*)pBuff) == szcbData)
+                {
+                    //All done!
+                    szcbRet = szcbData;
+                }
+                else
+                {
+                    //Overflow
+                    assert(false);
+
+#ifdef _WIN32
+                    //Microsoft specific code
+                    __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                    //General case
+                    abort();
+#endif
+                }
+            }
+            else
+                assert(false);
+        }
+        else
+        {
+            //Only needs the size
+            szcbRet = szcbData;
+        }
+
+        return szcbRet;
+    }
+
+
+
+
+
+
+    /// <summary>
+    /// De-serializes byte array produced by toByteArrayColumnar() into this struct.
+    /// Each column is validated in its entirety before any students are created.
+    /// </summary>
+    /// <param name="pData">Byte array to convert</param>
+    /// <param name="szcbData">Size of 'pData' in bytes</param>
+    /// <param name="pLimits">if not 0, limits on resources used by this call, that are checked before any memory is allocated</param>
+    /// <returns>[1 and up) if success, for amount of bytes used, 0 if error - in this case this struct will be reset</returns>
+    size_t fromByteArrayColumnar(const void* pData, size_t szcbData, const DecodeLimits* pLimits = nullptr)
+    {
+        DecodeBudget budget;
+        budget.pLimits = pLimits;
+
+        while(true)
+        {
+            //Do we have a pointer to data?
+            if(!pData)
+                break;
+
+            //Check overall data size provided
+            if((intptr_t)szcbData <= 0)
+                break;
+
+            const uint8_t* pS = (const uint8_t*)pData;
+            const uint8_t* pEnd = pS + szcbData;
+            assert(pEnd > pS);
+
+
+            //Check 'nYearEstablished'
+            if(!read_aligned(pS, pEnd, nYearEstablished))
+                break;
+
+            if(!isValidYear(nYearEstablished))
+                break;
+
+
+            //Check 'strName'
+            if(!read_aligned_str(pS, pEnd, strName, MAX_NAME_LEN_2, &budget))
+                break;
+
+            if(strName.empty())
+                break;
+
+
+            //Check 'students'
+            size_t szCntStudents;
+            if(!read_aligned(pS, pEnd, szCntStudents))
+                break;
+
+            if((intptr_t)szCntStudents < 0)
+                break;
+
+            if(pLimits &&
+                pLimits->szMaxStudents > 0 &&
+                szCntStudents > pLimits->szMaxStudents)
+                break;
+
+
+            //Locate and check fixed-size columns
+            //INFO: Each column is bounds-checked against what's left, which also limits 'szCntStudents'.
+            //      Values are then validated with SIMD kernels (see simd.h) many students at a time.
+            const uint8_t* pAges;
+            if(!read_aligned_array_ptr<int>(pS, pEnd, szCntStudents, pAges))
+                break;
+
+            if(Student::findInvalidAgeInColumn(pAges, szCntStudents) != szCntStudents)
+                break;
+
+            const uint8_t* pAttendances;
+            if(!read_aligned_array_ptr<AttendanceType>(pS, pEnd, szCntStudents, pAttendances))
+                break;
+
+            if(Student::findInvalidAttendanceInColumn(pAttendances, szCntStudents) != szCntStudents)
+                break;
+
+            const uint8_t* pSuspended;
+            if(!read_aligned_array_ptr<uint8_t>(pS, pEnd, (szCntStudents + 7) / 8, pSuspended))
+                break;
+
+            //Unused bits in the last byte of the bitmap must be 0
+            if(szCntStudents % 8 != 0 &&
+                (pSuspended[szCntStudents / 8] >> (szCntStudents % 8)) != 0)
+                break;
+
+            const uint8_t* pScores;
+            if(!read_aligned_array_ptr<double>(pS, pEnd, szCntStudents, pScores))
+                break;
+
+            if(Student::findInvalidScoreInColumn(pScores, szCntStudents) != szCntStudents)
+                break;
+
+
+            //Locate and check string columns
+            const uint8_t* pStrOffsets[std::size(kColumnStrs)];
+            const uint8_t* pStrChars[std::size(kColumnStrs)];
+
+            bool bReadColumnsOK = true;
+
+            for(size_t c = 0; c < std::size(kColumnStrs); c++)
+            {
+                if(!read_aligned_array_ptr<size_t>(pS, pEnd, szCntStudents, pStrOffsets[c]))
+                {
+                    bReadColumnsOK = false;
+                    break;
+                }
+
+                //Offsets must not decrease, and each string must fit its length limits
+                size_t szchPrev = 0;
+
+                for(size_t s = 0; s < szCntStudents; s++)
+                {
+                    size_t szchOffset;
+                    memcpy(&szchOffset, pStrOffsets[c] + s * sizeof(size_t), sizeof(size_t));
+
+                    if(szchOffset < szchPrev)
+                    {
+                        bReadColumnsOK = false;
+                        break;
+                    }
+
+                    size_t szchLen = szchOffset - szchPrev;
+
+                    if(kColumnStrs[c].szchMaxLen > 0 &&
+                        szchLen > kColumnStrs[c].szchMaxLen)
+                    {
+                        bReadColumnsOK = false;
+                        break;
+                    }
+
+                    if(kColumnStrs[c].bRequired &&
+                        szchLen == 0)
+                    {
+                        bReadColumnsOK = false;
+                        break;
+                    }
+
+                    if(!budget.addString(szchLen * sizeof(char)))
+                    {
+                        bReadColumnsOK = false;
+                        break;
+                    }
+
+                    szchPrev = szchOffset;
+                }
+
+                if(!bReadColumnsOK)
+                    break;
+
+                if(!read_aligned_array_ptr<char>(pS, pEnd, szchPrev, pStrChars[c]))
+                {
+                    bReadColumnsOK = false;
+                    break;
+                }
+            }
+
+            if(!bReadColumnsOK)
+                break;
+
+
+            //Check 'strNotes'
+            if(!read_aligned_str(pS, pEnd, strNotes.owned(), 0, &budget))
+                break;
+
+
+            //All columns are valid - now create students
+            if(!budget.addAllocation(szCntStudents * sizeof(Student)))
+                break;
+
+            students.clear();
+            students.resize(szCntStudents);
+
+            for(size_t s = 0; s < szCntStudents; s++)
+            {
+                Student& st = students[s];
+
+                memcpy(&st.nAge, pAges + s * sizeof(int), sizeof(int));
+                memcpy(&st.attendance, pAttendances + s * sizeof(AttendanceType), sizeof(AttendanceType));
+                st.bSuspended = (pSuspended[s / 8] >> (s % 8)) & 1;
+                memcpy(&st.fPerformanceScore, pScores + s * sizeof(double), sizeof(double));
+            }
+
+            for(size_t c = 0; c < std::size(kColumnStrs); c++)
+            {
+                size_t szchPrev = 0;
+
+                for(size_t s = 0; s < szCntStudents; s++)
+                {
+                    size_t szchOffset;
+                    memcpy(&szchOffset, pStrOffsets[c] + s * sizeof(size_t), sizeof(size_t));
+
+                    kColumnStrs[c].pfnSet(students[s], std::string_view(
+                        (const char*)(pStrChars[c] + szchPrev * sizeof(char)), 
+                        szchOffset - szchPrev));
+
+                    szchPrev = szchOffset;
+                }
+            }
+
+
+
+            //Sanity check
+            if(pS <= pEnd)
+            {
+                //Success!
+                return pS - (const uint8_t*)pData;
+            }
+            else
+            {
+                //Overflow
+                assert(false);
+
+#ifdef _WIN32
+                //Microsoft specific code
+                __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                //General case
+                abort();
+#endif
+            }
+
+
+            break;
+        }
+
+        //Failure to de-serialize
+
+        //Reset this struct
+        *this = MyClass();
+
+        return 0;
+    }
+
+
+
+
+    /// <summary>
+    /// Serializes this struct by converting it to a byte array, using dictionary encoding for student names.
+    /// Each unique name is stored once in a table of strings, and students refer to it by index.
+    /// Use fromByteArrayDict() to read it back.
+    /// </summary>
+    /// <param name="pBuff">if not 0, pointer to the buffer to fill out</param>
+    /// <param name="szcbBuff">Size of provided 'pBuff' in bytes</param>
+    /// <returns>Size of the filled (or needed to fill) buffer in bytes, or 0 if error</returns>
+    size_t toByteArrayDict(void* pBuff = nullptr, size_t szcbBuff = 0) const
+    {
+/*
+
+int nYearEstablished
+string strName
+size_t cnt_strings
+string strings[cnt_strings]
+size_t cnt_students
+student_data[]                  <- see Student::toByteArrayDict()
+string strNotes
+
+*/
+        size_t szcbRet = 0;
+
+        //Build table of unique names
+        std::vector<const std::string*> strTable;
+        std::vector<uint32_t> idxNames;
+
+        if(!buildNameTable(strTable, idxNames))
+        {
+            //Too many unique names
+            return 0;
+        }
+
+        //Determine the size needed
+        size_t szcbData = 
+            aligned(sizeof(nYearEstablished)) +
+            aligned_sizeof_str(strName) +
+            aligned(sizeof(size_t)) +               //Count of elements in the table of strings
+            aligned(sizeof(size_t)) +               //Count of elements in the 'students' array
+            aligned_sizeof_str(getNotesView());
+
+        for(const std::string* pStr : strTable)
+        {
+            szcbData += aligned_sizeof_str(*pStr);
+        }
+
+        for(size_t s = 0; s < students.size(); s++)
+        {
+            szcbData += students[s].toByteArrayDict(&idxNames[s * Student::CNT_DICT_NAMES]);
+        }
+
+        //Was the buffer provided?
+        if(pBuff)
+        {
+            //Compare the size provided
+            if(szcbBuff >= szcbData)
+            {
+                //Fill out the buffer
+                uint8_t* pD = (uint8_t*)pBuff;
+                uint8_t* pEnd = pD + szcbData;
+
+                //Clear provided buffer
+                memset(pD, 0, szcbData);
+
+                copy_aligned(pD, nYearEstablished);
+
+                copy_aligned_str(pD, strName);
+
+                //Table of strings
+                size_t szCntStrings = strTable.size();
+                copy_aligned(pD, szCntStrings);
+
+                for(const std::string* pStr : strTable)
+                {
+                    copy_aligned_str(pD, *pStr);
+                }
+
+                //Students array
+                size_t szCntStudents = students.size();
+                copy_aligned(pD, szCntStudents);
+
+                for(size_t s = 0; s < szCntStudents; s++)
+                {
+                    size_t szcb = students[s].toByteArrayDict(&idxNames[s * Student::CNT_DICT_NAMES], pD, pEnd - pD);
+                    if(!szcb)
+                    {
+                        //Failed
+                        assert(false);
+
+#ifdef _WIN32
+                        //Microsoft specific code
+                        __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                        //General case
+                        abort();
+#endif
+                    }
+
+                    pD += szcb;
+                }
+
+                //Add notes
+                copy_aligned_str(pD, getNotesView());
+
+
+                //Sanity check
+                if((size_t)(pD - (uint8_t*)pBuff) == szcbData)
+                {
+                    //All done!
+                    szcbRet = szcbData;
+                }
+                else
+                {
+                    //Overflow
+                    assert(false);
+
+#ifdef _WIN32
+                    //Microsoft specific code
+                    __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                    //General case
+                    abort();
+#endif
+                }
+            }
+            else
+                assert(false);
+        }
+        else
+        {
+            //Only needs the size
+            szcbRet = szcbData;
+        }
+
+        return szcbRet;
+    }
+
+
+
+
+
+
+    /// <summary>
+    /// De-serializes byte array produced by toByteArrayDict() into this struct.
+    /// Each unique name is validated only once.
+    /// </summary>
+    /// <param name="pData">Byte array to convert</param>
+    /// <param name="szcbData">Size of 'pData' in bytes</param>
+    /// <param name="pLimits">if not 0, limits on resources used by this call, that are checked before any memory is allocated.
+    ///                       If 0, names copied out of the table may not take more than DICT_MAX_EXPANSION times the size of 'pData'</param>
+    /// <returns>[1 and up) if success, for amount of bytes used, 0 if error - in this case this struct will be reset</returns>
+    size_t fromByteArrayDict(const void* pData, size_t szcbData, const DecodeLimits* pLimits = nullptr)
+    {
+        //Each student may refer to long names in the table, so a small byte array can expand into
+        //a lot of strings - always limit how much they can take
+        DecodeLimits limitsDefault;
+
+        if(!pLimits)
+        {
+            limitsDefault.szcbMaxStrings = szcbData <= SIZE_MAX / DICT_MAX_EXPANSION ? 
+                szcbData * DICT_MAX_EXPANSION : SIZE_MAX;
+
+            pLimits = &limitsDefault;
+        }
+
+        DecodeBudget budget;
+        budget.pLimits = pLimits;
+
+        while(true)
+        {
+            //Do we have a pointer to data?
+            if(!pData)
+                break;
+
+            //Check overall data size provided
+            if((intptr_t)szcbData <= 0)
+                break;
+
+            const uint8_t* pS = (const uint8_t*)pData;
+            const uint8_t* pEnd = pS + szcbData;
+            assert(pEnd > pS);
+
+
+            //Check 'nYearEstablished'
+            if(!read_aligned(pS, pEnd, nYearEstablished))
+                break;
+
+            if(!isValidYear(nYearEstablished))
+                break;
+
+
+            //Check 'strName'
+            if(!read_aligned_str(pS, pEnd, strName, MAX_NAME_LEN_2, &budget))
+                break;
+
+            if(strName.empty())
+                break;
+
+
+            //Check table of strings
+            size_t szCntStrings;
+            if(!read_aligned(pS, pEnd, szCntStrings))
+                break;
+
+            if(szCntStrings > UINT32_MAX)
+                break;
+
+            bool bReadStringsOK = true;
+            std::vector<std::string> strTable;
+
+            for(size_t i = 0; i < szCntStrings; i++)
+            {
+                //INFO: Don't reserve in advance - the count was not checked against the data yet
+                if(!budget.addAllocation(sizeof(std::string)))
+                {
+                    bReadStringsOK = false;
+                    break;
+                }
+
+                strTable.emplace_back();
+
+                if(!read_aligned_str(pS, pEnd, strTable.back(), MAX_NAME_LEN_1, &budget))
+                {
+                    //Failed
+                    bReadStringsOK = false;
+
+                    break;
+                }
+            }
+
+            if(!bReadStringsOK)
+                break;
+
+
+            //Check 'students'
+            size_t szCntStudents;
+            if(!read_aligned(pS, pEnd, szCntStudents))
+                break;
+
+            if((intptr_t)szCntStudents < 0)
+                break;
+
+            if(pLimits->szMaxStudents > 0 &&
+                szCntStudents > pLimits->szMaxStudents)
+                break;
+
+            //Get all students
+            bool bReadStudentsOK = true;
+            students.clear();
+
+            Student st;
+
+            for(size_t s = 0; s < szCntStudents; s++)
+            {
+                //INFO: Don't reserve in advance - the count was not checked against the data yet
+                if(!budget.addAllocation(sizeof(Student)))
+                {
+                    bReadStudentsOK = false;
+                    break;
+                }
+
+                size_t szcb = st.fromByteArrayDict(pS, pEnd - pS, strTable, &budget);
+                if(!szcb)
+                {
+                    //Failed
+                    bReadStudentsOK = false;
+
+                    break;
+                }
+
+                //Add student to the list
+                students.push_back(std::move(st));
+
+                pS += szcb;
+            }
+
+            if(!bReadStudentsOK)
+                break;
+
+
+            //Check 'strNotes'
+            if(!read_aligned_str(pS, pEnd, strNotes.owned(), 0, &budget))
+                break;
+
+
+
+            //Sanity check
+            if(pS <= pEnd)
+            {
+                //Success!
+                return pS - (const uint8_t*)pData;
+            }
+            else
+            {
+                //Overflow
+                assert(false);
+
+#ifdef _WIN32
+                //Microsoft specific code
+                __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                //General case
+                abort();
+#endif
+            }
+
+
+            break;
+        }
+
+        //Failure to de-serialize
+
+        //Reset this struct
+        *this = MyClass();
+
+        return 0;
+    }
+
+
+
+
+    /// <summary>
+    /// Serializes this struct by converting it to a byte array, same as toByteArray(),
+    /// and appends a CRC32C checksum of it to detect corruption. Use fromByteArrayWithCrc() to read it back.
+    /// </summary>
+    /// <param name="pBuff">if not 0, pointer to the buffer to fill out</param>
+    /// <param name="szcbBuff">Size of provided 'pBuff' in bytes</param>
+    /// <returns>Size of the filled (or needed to fill) buffer in bytes, or 0 if error</returns>
+    size_t toByteArrayWithCrc(void* pBuff = nullptr, size_t szcbBuff = 0) const
+    {
+/*
+
+size_t cb_class_data
+class_data                      <- see toByteArray()
+uint32_t crc32c                 <- of 'class_data'
+
+*/
+        size_t szcbRet = 0;
+
+        //Determine the size needed
+        size_t szcbClass = toByteArray();
+        if(!szcbClass)
+            return 0;
+
+        size_t szcbData = 
+            aligned(sizeof(size_t)) +               //Size of class data
+            szcbClass +
+            aligned(sizeof(uint32_t));              //Checksum
+
+        //Was the buffer provided?
+        if(pBuff)
+        {
+            //Compare the size provided
+            if(szcbBuff >= szcbData)
+            {
+                //Fill out the buffer
+                uint8_t* pD = (uint8_t*)pBuff;
+
+                memset(pD, 0, aligned(sizeof(szcbClass)));
+                copy_aligned(pD, szcbClass);
+
+                if(toByteArray(pD, szcbClass) != szcbClass)
+                {
+                    //Failed
+                    assert(false);
+
+#ifdef _WIN32
+                    //Microsoft specific code
+                    __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                    //General case
+                    abort();
+#endif
+                }
+
+                //Data is still in the cache, so this is cheap
+                uint32_t nCrc = crc32c(pD, szcbClass);
+
+                pD += szcbClass;
+
+                memset(pD, 0, aligned(sizeof(nCrc)));
+                copy_aligned(pD, nCrc);
+
+
+                //Sanity check
+                if((size_t)(pD - (uint8_t*)pBuff) == szcbData)
+                {
+                    //All done!
+                    szcbRet = szcbData;
+                }
+                else
+                {
+                    //Overflow
+                    assert(false);
+
+#ifdef _WIN32
+                    //Microsoft specific code
+                    __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                    //General case
+                    abort();
+#endif
+                }
+            }
+            else
+                assert(false);
+        }
+        else
+        {
+            //Only needs the size
+            szcbRet = szcbData;
+        }
+
+        return szcbRet;
+    }
+
+
+
+
+
+
+    /// <summary>
+    /// De-serializes byte array produced by toByteArrayWithCrc() into this struct.
+    /// The checksum is verified before the data is de-serialized.
+    /// </summary>
+    /// <param name="pData">Byte array to convert</param>
+    /// <param name="szcbData">Size of 'pData' in bytes</param>
+    /// <param name="pLimits">if not 0, limits on resources used by this call - see fromByteArray()</param>
+    /// <returns>[1 and up) if success, for amount of bytes used, 0 if error - in this case this struct will be reset</returns>
+    size_t fromByteArrayWithCrc(const void* pData, size_t szcbData, const DecodeLimits* pLimits = nullptr)
+    {
+        while(true)
+        {
+            //Do we have a pointer to data?
+            if(!pData)
+                break;
+
+            //Check overall data size provided
+            if((intptr_t)szcbData <= 0)
+                break;
+
+            const uint8_t* pS = (const uint8_t*)pData;
+            const uint8_t* pEnd = pS + szcbData;
+            assert(pEnd > pS);
+
+
+            //Check 'cb_class_data'
+            size_t szcbClass;
+            if(!read_aligned(pS, pEnd, szcbClass))
+                break;
+
+            if(szcbClass == 0 ||
+                szcbClass > (size_t)(pEnd - pS))
+                break;
+
+            const uint8_t* pClass = pS;
+            pS += szcbClass;
+
+
+            //Check 'crc32c'
+            const uint8_t* pCrc = pS;
+
+            uint32_t nCrc;
+            if(!read_aligned(pS, pEnd, nCrc))
+                break;
+
+            //Its alignment padding is not covered by the checksum, so it must be 0, as it was written
+            bool bPaddingOK = true;
+
+            for(const uint8_t* p = pCrc + sizeof(nCrc); p < pS; p++)
+            {
+                if(*p != 0)
+                {
+                    bPaddingOK = false;
+                    break;
+                }
+            }
+
+            if(!bPaddingOK)
+                break;
+
+            if(nCrc != crc32c(pClass, szcbClass))
+            {
+                //Data is corrupted
+                break;
+            }
+
+
+            //Check class data
+            if(fromByteArray(pClass, szcbClass, false, pLimits) != szcbClass)
+                break;
+
+
+            //Sanity check
+            if(pS <= pEnd)
+            {
+                //Success!
+                return pS - (const uint8_t*)pData;
+            }
+            else
+            {
+                //Overflow
+                assert(false);
+
+#ifdef _WIN32
+                //Microsoft specific code
+                __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                //General case
+                abort();
+#endif
+            }
+
+
+            break;
+        }
+
+        //Failure to de-serialize
+
+        //Reset this struct
+        *this = MyClass();
+
+        return 0;
+    }
+
+
+
+private:
+
+    //Describes a string field of the 'Student' struct in the columnar encoding
+    struct ColumnStr
+    {
+        std::string_view (*pfnGet)(const Student& st);          //Returns value of the field
+        void (*pfnSet)(Student& st, std::string_view str);      //Sets value of the field
+        size_t szchMaxLen;                                      //if not 0, maximum allowed length in characters
+        bool bRequired;                                         //true if string must not be empty
+    };
+
+    static constexpr ColumnStr kColumnStrs[] = {
+        {
+            [](const Student& st) -> std::string_view { return st.strGivenName; },
+            [](Student& st, std::string_view str) { st.strGivenName.assign(str); },
+            MAX_NAME_LEN_1, true
+        },
+        {
+            [](const Student& st) -> std::string_view { return st.strSecondName; },
+            [](Student& st, std::string_view str) { st.strSecondName.assign(str); },
+            MAX_NAME_LEN_1, false
+        },
+        {
+            [](const Student& st) -> std::string_view { return st.strThirdName; },
+            [](Student& st, std::string_view str) { st.strThirdName.assign(str); },
+            MAX_NAME_LEN_1, false
+        },
+        {
+            //Notes may have been de-serialized lazily
+            [](const Student& st) -> std::string_view { return st.getNotesView(); },
+            [](Student& st, std::string_view str) { st.setNotes(str); },
+            0, false
+        },
+    };
+
+
+
+    /// <summary>
+    /// Builds table of unique student names for the dictionary encoding
+    /// </summary>
+    /// <param name="strTable">Receives unique names, in the order of their first use</param>
+    /// <param name="idxNames">Receives Student::CNT_DICT_NAMES indexes into 'strTable' per student, one after another</param>
+    /// <returns>true if success, false if there are too many unique names</returns>
+    bool buildNameTable(std::vector<const std::string*>& strTable, std::vector<uint32_t>& idxNames) const
+    {
+        std::unordered_map<std::string_view, uint32_t> mapIndexes;
+
+        strTable.clear();
+        idxNames.clear();
+        idxNames.reserve(students.size() * Student::CNT_DICT_NAMES);
+
+        for(const Student& st : students)
+        {
+            for(const std::string* pStr : { &st.strGivenName, &st.strSecondName, &st.strThirdName })
+            {
+                auto itr = mapIndexes.find(*pStr);
+                if(itr == mapIndexes.end())
+                {
+                    if(strTable.size() >= UINT32_MAX)
+                        return false;
+
+                    itr = mapIndexes.emplace(*pStr, (uint32_t)strTable.size()).first;
+                    strTable.push_back(pStr);
+                }
+
+                idxNames.push_back(itr->second);
+            }
+        }
+
+        return true;
+    }
+
+
+};
@@ -0,0 +1,284 @@
+// This is a Proof-of-Concept (POC) project that demonstrates
+// secure coding practices when programming binary
+// serialization & de-serialization in C++.
+//
+// Copyright (c) 2023, by dennisbabkin.com
+//
+//
+// This project is used in the following blog post:
+//
+//  "Secure Programming Practices - Serialization"
+//  "Example of secure binary serialization and de-serialization in C++."
+//
+//   https://dennisbabkin.com/blog/?i=AAA12200
+//
+
+
+//Asynchronous loader of many files with serialized MyClass
+//
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "MyClass.h"
+
+
+
+
+//Result of loading one file
+struct LoadedMyClass
+{
+    //Path of the file
+    std::filesystem::path path;
+
+    //true if the file was read and de-serialized
+    bool bSuccess = false;
+
+    //De-serialized class, or empty if 'bSuccess' is false
+    MyClass obj;
+};
+
+
+
+
+//Loads files on a pool of worker threads, where each thread reads a file and
+//de-serializes it with MyClass::fromByteArray(). This overlaps reading of some
+//files with decoding of others on all cores. Results are delivered through
+//a bounded queue, in the order in which they finish.
+class MyClassLoader
+{
+public:
+
+    /// <summary>
+    /// Starts loading files in the background
+    /// </summary>
+    /// <param name="paths">Files to load</param>
+    /// <param name="szMaxQueued">Maximum number of loaded results waiting in the queue, workers pause when it's full</param>
+    /// <param name="nThreads">Number of worker threads, or 0 to use the number of CPUs</param>
+    /// <param name="szcbMaxFile">Files larger than this are not loaded and fail</param>
+    /// <param name="pLimits">if not 0, limits on resources used by de-serialization - see MyClass::fromByteArray()</param>
+    MyClassLoader(std::vector<std::filesystem::path> paths,
+        size_t szMaxQueued = 64,
+        unsigned int nThreads = 0,
+        size_t szcbMaxFile = 256 * 1024 * 1024,
+        const DecodeLimits* pLimits = nullptr
+        )
+        : _paths(std::move(paths))
+        , _szMaxQueued(szMaxQueued ? szMaxQueued : 1)
+        , _szcbMaxFile(szcbMaxFile)
+    {
+        if(pLimits)
+        {
+            _limits = *pLimits;
+        }
+
+        if(!nThreads)
+        {
+            nThreads = std::thread::hardware_concurrency();
+            if(!nThreads)
+                nThreads = 1;
+        }
+
+        if(nThreads > _paths.size())
+        {
+            nThreads = (unsigned int)_paths.size();
+        }
+
+        _threads.reserve(nThreads);
+
+        try
+        {
+            for(unsigned int t = 0; t < nThreads; t++)
+            {
+                _threads.emplace_back(&MyClassLoader::_workerThread, this);
+            }
+        }
+        catch(...)
+        {
+            //The destructor won't be called, and destroying a joinable thread calls std::terminate
+            _stopWorkers();
+
+            throw;
+        }
+    }
+
+
+    ~MyClassLoader()
+    {
+        _stopWorkers();
+    }
+
+
+    MyClassLoader(const MyClassLoader&) = delete;
+    MyClassLoader& operator=(const MyClassLoader&) = delete;
+
+
+
+
+    /// <summary>
+    /// Waits for the next loaded file
+    /// </summary>
+    /// <param name="result">Receives the result of loading a file</param>
+    /// <returns>true if 'result' was set, false if all files have been already delivered</returns>
+    bool getNext(LoadedMyClass& result)
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+
+        if(_szCntDelivered >= _paths.size())
+        {
+            //All done
+            return false;
+        }
+
+        _cvNotEmpty.wait(lock, [this] { return !_queue.empty(); });
+
+        result = std::move(_queue.front());
+        _queue.pop_front();
+
+        _szCntDelivered++;
+
+        lock.unlock();
+
+        _cvNotFull.notify_one();
+
+        return true;
+    }
+
+
+
+private:
+
+    /// <summary>
+    /// Stops workers that may be waiting on a full queue, and waits for all of them to finish
+    /// </summary>
+    void _stopWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _bStop = true;
+        }
+
+        _cvNotFull.notify_all();
+
+        for(std::thread& thrd : _threads)
+        {
+            thrd.join();
+        }
+    }
+
+
+
+    /// <summary>
+    /// Reads a whole file into memory
+    /// </summary>
+    /// <param name="path">File to read</param>
+    /// <param name="data">Receives file contents</param>
+    /// <returns>true if success</returns>
+    bool _readFile(const std::filesystem::path& path, std::vector<uint8_t>& data) const
+    {
+        std::ifstream file(path, std::ios::binary);
+        if(!file)
+            return false;
+
+        file.seekg(0, std::ios::end);
+        std::streamoff szcbFile = file.tellg();
+
+        if(szcbFile <= 0 ||
+            (uint64_t)szcbFile > _szcbMaxFile)
+            return false;
+
+        file.seekg(0, std::ios::beg);
+
+        data.resize((size_t)szcbFile);
+
+        return (bool)file.read((char*)data.data(), szcbFile);
+    }
+
+
+
+    /// <summary>
+    /// Worker thread that loads files until there are none left
+    /// </summary>
+    void _workerThread()
+    {
+        std::vector<uint8_t> data;
+
+        for(;;)
+        {
+            size_t szIndex = _szNextPath.fetch_add(1);
+            if(szIndex >= _paths.size())
+            {
+                //No more files
+                break;
+            }
+
+            LoadedMyClass result;
+
+            try
+            {
+                result.path = _paths[szIndex];
+
+                if(_readFile(result.path, data))
+                {
+                    result.bSuccess = result.obj.fromByteArray(data.data(), data.size(), false, _limits ? &*_limits : nullptr) == data.size();
+                }
+            }
+            catch(...)
+            {
+                //Out of memory, or a file I/O error - this file fails, but others can still load
+                result.bSuccess = false;
+                result.obj = MyClass();
+
+                //Don't hold on to a large buffer
+                std::vector<uint8_t>().swap(data);
+            }
+
+            //Wait for space in the queue
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+
+                _cvNotFull.wait(lock, [this] { return _bStop || _queue.size() < _szMaxQueued; });
+
+                if(_bStop)
+                    break;
+
+                _queue.push_back(std::move(result));
+            }
+
+            _cvNotEmpty.notify_one();
+        }
+    }
+
+
+
+
+private:
+
+    const std::vector<std::filesystem::path> _paths;        //Files to load
+    const size_t _szMaxQueued;                              //Maximum number of results in '_queue'
+    const size_t _szcbMaxFile;                              //Maximum allowed file size in bytes
+    std::optional<DecodeLimits> _limits;                    //Limits for de-serialization, if used
+
+    std::atomic<size_t> _szNextPath = 0;                    //Index in '_paths' of the next file to load
+
+    std::mutex _mtx;                                        //Protects members below
+    std::condition_variable _cvNotEmpty;                    //Signaled when a result is added to '_queue'
+    std::condition_variable _cvNotFull;                     //Signaled when a result is taken from '_queue', or when stopping
+    std::deque<LoadedMyClass> _queue;                       //Loaded results waiting to be delivered
+    size_t _szCntDelivered = 0;                             //Number of results returned by getNext()
+    bool _bStop = false;                                    //true to stop workers
+
+    std::vector<std::thread> _threads;                      //Worker threads - MUST BE LAST to start after all other members were initialized
+};
+
+
+
+
@@ -0,0 +1,903 @@
+// This is a Proof-of-Concept (POC) project that demonstrates
+// secure coding practices when programming binary
+// serialization & de-serialization in C++.
+//
+// Copyright (c) 2023, by dennisbabkin.com
+//
+//
+// This project is used in the following blog post:
+//
+//  "Secure Programming Practices - Serialization"
+//  "Example of secure binary serialization and de-serialization in C++."
+//
+//   https://dennisbabkin.com/blog/?i=AAA12200
+//
+
+
+//Patch with changes between two instances of MyClass, to avoid re-sending the whole class
+//
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "MyClass.h"
+
+
+
+
+//Flags for fields of the 'Student' struct that were changed
+enum StudentPatchFields : uint32_t
+{
+    SPF_AGE                 = 0x1,
+    SPF_GIVEN_NAME          = 0x2,
+    SPF_SECOND_NAME         = 0x4,
+    SPF_THIRD_NAME          = 0x8,
+    SPF_ATTENDANCE          = 0x10,
+    SPF_SUSPENDED           = 0x20,
+    SPF_PERFORMANCE_SCORE   = 0x40,
+    SPF_NOTES               = 0x80,
+
+    SPF_ALL                 = 0xFF,             //All fields - used for added students
+};
+
+
+//Flags for fields of the 'MyClass' struct that were changed
+enum MyClassPatchFields : uint32_t
+{
+    MPF_YEAR_ESTABLISHED    = 0x1,
+    MPF_NAME                = 0x2,
+    MPF_NOTES               = 0x4,
+
+    MPF_ALL                 = 0x7,
+};
+
+
+
+
+//Changes to a single student
+struct StudentPatch
+{
+    //Index of the student in the 'MyClass::students' array
+    size_t szIndex = 0;
+
+    //Fields that were changed, or SPF_ALL for a new student - see StudentPatchFields
+    uint32_t dwFields = 0;
+
+    //New values of changed fields, other fields are not used
+    Student st;
+
+
+
+
+    /// <summary>
+    /// De-serializes byte array into this struct
+    /// </summary>
+    /// <param name="pData">Byte array to convert</param>
+    /// <param name="szcbData">Size of 'pData' in bytes</param>
+    /// <param name="pBudget">if not 0, resources used by this de-serialization call, to check against its limits and update</param>
+    /// <returns>[1 and up) if success, for amount of bytes used, 0 if error - in this case this struct will be reset</returns>
+    size_t fromByteArray(const void* pData, size_t szcbData, DecodeBudget* pBudget = nullptr)
+    {
+        while(true)
+        {
+            //Do we have a pointer to data?
+            if(!pData)
+                break;
+
+            //Check overall data size provided
+            if((intptr_t)szcbData <= 0)
+                break;
+
+            const uint8_t* pS = (const uint8_t*)pData;
+            const uint8_t* pEnd = pS + szcbData;
+            assert(pEnd > pS);
+
+
+            //Check 'szIndex'
+            if(!read_aligned(pS, pEnd, szIndex))
+                break;
+
+            if((intptr_t)szIndex < 0)
+                break;
+
+
+            //Check 'dwFields'
+            if(!read_aligned(pS, pEnd, dwFields))
+                break;
+
+            if(dwFields == 0 ||
+                (dwFields & ~SPF_ALL) != 0)
+                break;
+
+            st = Student();
+
+
+            //Check 'nAge'
+            if(dwFields & SPF_AGE)
+            {
+                if(!read_aligned(pS, pEnd, st.nAge))
+                    break;
+
+                if(!Student::isValidAge(st.nAge))
+                    break;
+            }
+
+
+            //Check 'strGivenName'
+            if(dwFields & SPF_GIVEN_NAME)
+            {
+                if(!read_aligned_str(pS, pEnd, st.strGivenName, MAX_NAME_LEN_1, pBudget))
+                    break;
+
+                if(st.strGivenName.empty())
+                    break;
+            }
+
+
+            //Check 'strSecondName'
+            if(dwFields & SPF_SECOND_NAME)
+            {
+                if(!read_aligned_str(pS, pEnd, st.strSecondName, MAX_NAME_LEN_1, pBudget))
+                    break;
+            }
+
+
+            //Check 'strThirdName'
+            if(dwFields & SPF_THIRD_NAME)
+            {
+                if(!read_aligned_str(pS, pEnd, st.strThirdName, MAX_NAME_LEN_1, pBudget))
+                    break;
+            }
+
+
+            //Check 'attendance'
+            if(dwFields & SPF_ATTENDANCE)
+            {
+                if(!read_aligned(pS, pEnd, st.attendance))
+                    break;
+
+                if(!Student::isValidAttendance(st.attendance))
+                    break;
+            }
+
+
+            //Check 'bSuspended'
+            if(dwFields & SPF_SUSPENDED)
+            {
+                //read_aligned() accepts only 0 or 1 for a bool
+                if(!read_aligned(pS, pEnd, st.bSuspended))
+                    break;
+            }
+
+
+            //Check 'fPerformanceScore'
+            if(dwFields & SPF_PERFORMANCE_SCORE)
+            {
+                if(!read_aligned_double(pS, pEnd, st.fPerformanceScore))
+                    break;
+            }
+
+
+            //Check 'strNotes'
+            if(dwFields & SPF_NOTES)
+            {
+                std::string strNotes;
+                if(!read_aligned_str(pS, pEnd, strNotes, 0, pBudget))
+                    break;
+
+                st.setNotes(strNotes);
+            }
+
+
+            //Sanity check
+            if(pS <= pEnd)
+            {
+                //Success!
+                return pS - (const uint8_t*)pData;
+            }
+            else
+            {
+                //Overflow
+                assert(false);
+
+#ifdef _WIN32
+                //Microsoft specific code
+                __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                //General case
+                abort();
+#endif
+            }
+
+
+            break;
+        }
+
+        //Failure to de-serialize
+
+        //Reset this struct
+        *this = StudentPatch();
+
+        return 0;
+    }
+
+
+
+
+
+    /// <summary>
+    /// Serializes this struct by converting it to a byte array
+    /// </summary>
+    /// <param name="pBuff">if not 0, pointer to the buffer to fill out</param>
+    /// <param name="szcbBuff">Size of provided 'pBuff' in bytes</param>
+    /// <returns>Size of the filled (or needed to fill) buffer in bytes, or 0 if error</returns>
+    size_t toByteArray(void* pBuff = nullptr, size_t szcbBuff = 0) const
+    {
+/*
+
+size_t szIndex
+uint32_t dwFields
+[fields of the Student struct, in the same order, only if their flag is set in 'dwFields']
+
+*/
+        size_t szcbRet = 0;
+
+        //Determine the size needed
+        size_t szcbData =
+            aligned(sizeof(szIndex)) +
+            aligned(sizeof(dwFields)) +
+            (dwFields & SPF_AGE ? aligned(sizeof(st.nAge)) : 0) +
+            (dwFields & SPF_GIVEN_NAME ? aligned_sizeof_str(st.strGivenName) : 0) +
+            (dwFields & SPF_SECOND_NAME ? aligned_sizeof_str(st.strSecondName) : 0) +
+            (dwFields & SPF_THIRD_NAME ? aligned_sizeof_str(st.strThirdName) : 0) +
+            (dwFields & SPF_ATTENDANCE ? aligned(sizeof(st.attendance)) : 0) +
+            (dwFields & SPF_SUSPENDED ? aligned(sizeof(st.bSuspended)) : 0) +
+            (dwFields & SPF_PERFORMANCE_SCORE ? aligned(sizeof(st.fPerformanceScore)) : 0) +
+            (dwFields & SPF_NOTES ? aligned_sizeof_str(st.getNotesView()) : 0);
+
+        //Was the buffer provided?
+        if(pBuff)
+        {
+            //Compare the size provided
+            if(szcbBuff >= szcbData)
+            {
+                //Fill out the buffer
+                uint8_t* pD = (uint8_t*)pBuff;
+
+                //Clear provided buffer
+                memset(pD, 0, szcbData);
+
+                copy_aligned(pD, szIndex);
+                copy_aligned(pD, dwFields);
+
+                if(dwFields & SPF_AGE)
+                    copy_aligned(pD, st.nAge);
+
+                if(dwFields & SPF_GIVEN_NAME)
+                    copy_aligned_str(pD, st.strGivenName);
+
+                if(dwFields & SPF_SECOND_NAME)
+                    copy_aligned_str(pD, st.strSecondName);
+
+                if(dwFields & SPF_THIRD_NAME)
+                    copy_aligned_str(pD, st.strThirdName);
+
+                if(dwFields & SPF_ATTENDANCE)
+                    copy_aligned(pD, st.attendance);
+
+                if(dwFields & SPF_SUSPENDED)
+                    copy_aligned(pD, st.bSuspended);
+
+                if(dwFields & SPF_PERFORMANCE_SCORE)
+                    copy_aligned(pD, st.fPerformanceScore);
+
+                if(dwFields & SPF_NOTES)
+                    copy_aligned_str(pD, st.getNotesView());
+
+
+                //Sanity check
+                if((size_t)(pD - (uint8_t*)pBuff) == szcbData)
+                {
+                    //All done!
+                    szcbRet = szcbData;
+                }
+                else
+                {
+                    //Overflow
+                    assert(false);
+
+#ifdef _WIN32
+                    //Microsoft specific code
+                    __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                    //General case
+                    abort();
+#endif
+                }
+            }
+            else
+                assert(false);
+        }
+        else
+        {
+            //Only needs the size
+            szcbRet = szcbData;
+        }
+
+        return szcbRet;
+    }
+
+
+
+    /// <summary>
+    /// Checks values of the changed fields, using the same rules as Student::fromByteArray()
+    /// </summary>
+    /// <returns>true if valid</returns>
+    bool isValid() const
+    {
+        if(dwFields == 0 ||
+            (dwFields & ~SPF_ALL) != 0)
+            return false;
+
+        if((dwFields & SPF_AGE) &&
+            !Student::isValidAge(st.nAge))
+            return false;
+
+        if((dwFields & SPF_GIVEN_NAME) &&
+            (st.strGivenName.empty() || st.strGivenName.size() > MAX_NAME_LEN_1))
+            return false;
+
+        if((dwFields & SPF_SECOND_NAME) &&
+            st.strSecondName.size() > MAX_NAME_LEN_1)
+            return false;
+
+        if((dwFields & SPF_THIRD_NAME) &&
+            st.strThirdName.size() > MAX_NAME_LEN_1)
+            return false;
+
+        if((dwFields & SPF_ATTENDANCE) &&
+            !Student::isValidAttendance(st.attendance))
+            return false;
+
+        if((dwFields & SPF_PERFORMANCE_SCORE) &&
+            !std::isfinite(st.fPerformanceScore))
+            return false;
+
+        return true;
+    }
+
+
+
+    /// <summary>
+    /// Copies changed fields into 'dest'
+    /// </summary>
+    /// <param name="dest">Student to update</param>
+    void applyTo(Student& dest) const
+    {
+        copyFields(dwFields, st, dest);
+    }
+
+
+
+    /// <summary>
+    /// Copies fields between students
+    /// </summary>
+    /// <param name="dwFields">Fields to copy - see StudentPatchFields</param>
+    /// <param name="src">Student to copy from</param>
+    /// <param name="dest">Student to copy to</param>
+    static void copyFields(uint32_t dwFields, const Student& src, Student& dest)
+    {
+        if(dwFields & SPF_AGE)
+            dest.nAge = src.nAge;
+
+        if(dwFields & SPF_GIVEN_NAME)
+            dest.strGivenName = src.strGivenName;
+
+        if(dwFields & SPF_SECOND_NAME)
+            dest.strSecondName = src.strSecondName;
+
+        if(dwFields & SPF_THIRD_NAME)
+            dest.strThirdName = src.strThirdName;
+
+        if(dwFields & SPF_ATTENDANCE)
+            dest.attendance = src.attendance;
+
+        if(dwFields & SPF_SUSPENDED)
+            dest.bSuspended = src.bSuspended;
+
+        if(dwFields & SPF_PERFORMANCE_SCORE)
+            dest.fPerformanceScore = src.fPerformanceScore;
+
+        if(dwFields & SPF_NOTES)
+            dest.setNotes(src.getNotesView());
+
+        //Serialized bytes are no longer valid
+        dest.invalidate();
+    }
+
+
+};
+
+
+
+
+
+
+//Changes between two instances of MyClass
+struct MyClassPatch
+{
+    //Fields of MyClass that were changed - see MyClassPatchFields
+    uint32_t dwFields = 0;
+
+    //New values of changed fields, other fields are not used
+    int nYearEstablished = 0;
+    std::string strName;
+    std::string strNotes;
+
+    //New number of students. Students above it are removed.
+    size_t szCntStudents = 0;
+
+    //Changed and added students, sorted by 'StudentPatch::szIndex'
+    //INFO: A student removed from the middle of the array shows up as changes to all students after it.
+    std::vector<StudentPatch> students;
+
+
+
+
+    /// <summary>
+    /// Creates a patch that converts 'from' into 'to'
+    /// </summary>
+    /// <param name="from">Original version</param>
+    /// <param name="to">Updated version</param>
+    /// <returns>Patch to pass to apply()</returns>
+    static MyClassPatch diff(const MyClass& from, const MyClass& to)
+    {
+        MyClassPatch patch;
+
+        if(from.nYearEstablished != to.nYearEstablished)
+        {
+            patch.dwFields |= MPF_YEAR_ESTABLISHED;
+            patch.nYearEstablished = to.nYearEstablished;
+        }
+
+        if(from.strName != to.strName)
+        {
+            patch.dwFields |= MPF_NAME;
+            patch.strName = to.strName;
+        }
+
+        if(from.getNotesView() != to.getNotesView())
+        {
+            patch.dwFields |= MPF_NOTES;
+            patch.strNotes = to.getNotesView();
+        }
+
+        patch.szCntStudents = to.students.size();
+
+        for(size_t s = 0; s < to.students.size(); s++)
+        {
+            const Student& stTo = to.students[s];
+
+            uint32_t dwStFields = SPF_ALL;
+
+            if(s < from.students.size())
+            {
+                //Compare fields of existing student
+                const Student& stFrom = from.students[s];
+
+                //INFO: Compare scores bit by bit, since 0.0 == -0.0 but they are serialized differently
+                static_assert(sizeof(double) == sizeof(uint64_t), "Unsupported size of double");
+
+                uint64_t nScoreFrom, nScoreTo;
+                memcpy(&nScoreFrom, &stFrom.fPerformanceScore, sizeof(nScoreFrom));
+                memcpy(&nScoreTo, &stTo.fPerformanceScore, sizeof(nScoreTo));
+
+                dwStFields =
+                    (stFrom.nAge != stTo.nAge ? (uint32_t)SPF_AGE : 0u) |
+                    (stFrom.strGivenName != stTo.strGivenName ? (uint32_t)SPF_GIVEN_NAME : 0u) |
+                    (stFrom.strSecondName != stTo.strSecondName ? (uint32_t)SPF_SECOND_NAME : 0u) |
+                    (stFrom.strThirdName != stTo.strThirdName ? (uint32_t)SPF_THIRD_NAME : 0u) |
+                    (stFrom.attendance != stTo.attendance ? (uint32_t)SPF_ATTENDANCE : 0u) |
+                    (stFrom.bSuspended != stTo.bSuspended ? (uint32_t)SPF_SUSPENDED : 0u) |
+                    (nScoreFrom != nScoreTo ? (uint32_t)SPF_PERFORMANCE_SCORE : 0u) |
+                    (stFrom.getNotesView() != stTo.getNotesView() ? (uint32_t)SPF_NOTES : 0u);
+
+                if(!dwStFields)
+                {
+                    //No changes
+                    continue;
+                }
+            }
+
+            StudentPatch& sp = patch.students.emplace_back();
+            sp.szIndex = s;
+            sp.dwFields = dwStFields;
+
+            //Copy only changed fields
+            StudentPatch::copyFields(dwStFields, stTo, sp.st);
+        }
+
+        return patch;
+    }
+
+
+
+
+    /// <summary>
+    /// Applies this patch to 'obj', using the same validation rules as MyClass::fromByteArray().
+    /// The patch is checked in its entirety before 'obj' is modified.
+    /// </summary>
+    /// <param name="obj">Class to update</param>
+    /// <returns>true if success, false if patch is not valid for 'obj' - in this case 'obj' is not changed</returns>
+    bool apply(MyClass& obj) const
+    {
+        //Check class fields
+        if(dwFields & ~MPF_ALL)
+            return false;
+
+        if(dwFields & MPF_YEAR_ESTABLISHED)
+        {
+            if(!MyClass::isValidYear(nYearEstablished))
+                return false;
+        }
+
+        if(dwFields & MPF_NAME)
+        {
+            if(strName.empty() ||
+                strName.size() > MAX_NAME_LEN_2)
+                return false;
+        }
+
+        //Check students
+        if((intptr_t)szCntStudents < 0)
+            return false;
+
+        size_t szCntOld = obj.students.size();
+        size_t szNextNew = szCntOld;            //Next index of a student that must be added
+
+        for(size_t i = 0; i < students.size(); i++)
+        {
+            const StudentPatch& sp = students[i];
+
+            //Indexes must be in ascending order and without duplicates
+            if(i > 0 &&
+                sp.szIndex <= students[i - 1].szIndex)
+                return false;
+
+            if(sp.szIndex >= szCntStudents)
+                return false;
+
+            if(!sp.isValid())
+                return false;
+
+            if(sp.szIndex >= szCntOld)
+            {
+                //New students must be added one after another, with all fields
+                if(sp.szIndex != szNextNew ||
+                    sp.dwFields != SPF_ALL)
+                    return false;
+
+                szNextNew++;
+            }
+        }
+
+        if(szCntStudents > szCntOld &&
+            szNextNew != szCntStudents)
+        {
+            //Not all added students were provided
+            return false;
+        }
+
+
+        //All good - now update the class
+        if(dwFields & MPF_YEAR_ESTABLISHED)
+            obj.nYearEstablished = nYearEstablished;
+
+        if(dwFields & MPF_NAME)
+            obj.strName = strName;
+
+        if(dwFields & MPF_NOTES)
+            obj.setNotes(strNotes);
+
+        obj.students.resize(szCntStudents);
+
+        for(const StudentPatch& sp : students)
+        {
+            sp.applyTo(obj.students[sp.szIndex]);
+        }
+
+        return true;
+    }
+
+
+
+
+    /// <summary>
+    /// De-serializes byte array into this struct
+    /// </summary>
+    /// <param name="pData">Byte array to convert</param>
+    /// <param name="szcbData">Size of 'pData' in bytes</param>
+    /// <param name="pLimits">if not 0, limits on resources used by this call, that are checked before any memory is allocated.
+    ///                       Its 'szMaxStudents' limits the number of students in the class after the patch is applied</param>
+    /// <returns>[1 and up) if success, for amount of bytes used, 0 if error - in this case this struct will be reset</returns>
+    size_t fromByteArray(const void* pData, size_t szcbData, const DecodeLimits* pLimits = nullptr)
+    {
+        DecodeBudget budget;
+        budget.pLimits = pLimits;
+
+        while(true)
+        {
+            //Do we have a pointer to data?
+            if(!pData)
+                break;
+
+            //Check overall data size provided
+            if((intptr_t)szcbData <= 0)
+                break;
+
+            const uint8_t* pS = (const uint8_t*)pData;
+            const uint8_t* pEnd = pS + szcbData;
+            assert(pEnd > pS);
+
+
+            //Check 'dwFields'
+            if(!read_aligned(pS, pEnd, dwFields))
+                break;
+
+            if(dwFields & ~MPF_ALL)
+                break;
+
+
+            //Check 'nYearEstablished'
+            if(dwFields & MPF_YEAR_ESTABLISHED)
+            {
+                if(!read_aligned(pS, pEnd, nYearEstablished))
+                    break;
+
+                if(!MyClass::isValidYear(nYearEstablished))
+                    break;
+            }
+
+
+            //Check 'strName'
+            if(dwFields & MPF_NAME)
+            {
+                if(!read_aligned_str(pS, pEnd, strName, MAX_NAME_LEN_2, &budget))
+                    break;
+
+                if(strName.empty())
+                    break;
+            }
+
+
+            //Check 'strNotes'
+            if(dwFields & MPF_NOTES)
+            {
+                if(!read_aligned_str(pS, pEnd, strNotes, 0, &budget))
+                    break;
+            }
+
+
+            //Check 'szCntStudents'
+            if(!read_aligned(pS, pEnd, szCntStudents))
+                break;
+
+            if((intptr_t)szCntStudents < 0)
+                break;
+
+            if(pLimits &&
+                pLimits->szMaxStudents > 0 &&
+                szCntStudents > pLimits->szMaxStudents)
+                break;
+
+
+            //Check 'students'
+            size_t szCntChanges;
+            if(!read_aligned(pS, pEnd, szCntChanges))
+                break;
+
+            if(szCntChanges > szCntStudents)
+                break;
+
+            bool bReadStudentsOK = true;
+            students.clear();
+
+            StudentPatch sp;
+
+            for(size_t s = 0; s < szCntChanges; s++)
+            {
+                //INFO: Don't reserve in advance - the count was not checked against the data yet
+                if(!budget.addAllocation(sizeof(StudentPatch)))
+                {
+                    bReadStudentsOK = false;
+                    break;
+                }
+
+                size_t szcb = sp.fromByteArray(pS, pEnd - pS, &budget);
+                if(!szcb)
+                {
+                    //Failed
+                    bReadStudentsOK = false;
+
+                    break;
+                }
+
+                //Indexes must be in ascending order and within the count
+                if(sp.szIndex >= szCntStudents ||
+                    (!students.empty() && sp.szIndex <= students.back().szIndex))
+                {
+                    bReadStudentsOK = false;
+
+                    break;
+                }
+
+                students.push_back(sp);
+
+                pS += szcb;
+            }
+
+            if(!bReadStudentsOK)
+                break;
+
+
+
+            //Sanity check
+            if(pS <= pEnd)
+            {
+                //Success!
+                return pS - (const uint8_t*)pData;
+            }
+            else
+            {
+                //Overflow
+                assert(false);
+
+#ifdef _WIN32
+                //Microsoft specific code
+                __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                //General case
+                abort();
+#endif
+            }
+
+
+            break;
+        }
+
+        //Failure to de-serialize
+
+        //Reset this struct
+        *this = MyClassPatch();
+
+        return 0;
+    }
+
+
+
+
+
+
+    /// <summary>
+    /// Serializes this struct by converting it to a byte array
+    /// </summary>
+    /// <param name="pBuff">if not 0, pointer to the buffer to fill out</param>
+    /// <param name="szcbBuff">Size of provided 'pBuff' in bytes</param>
+    /// <returns>Size of the filled (or needed to fill) buffer in bytes, or 0 if error</returns>
+    size_t toByteArray(void* pBuff = nullptr, size_t szcbBuff = 0) const
+    {
+/*
+
+uint32_t dwFields
+[int nYearEstablished]              <- if MPF_YEAR_ESTABLISHED
+[string strName]                    <- if MPF_NAME
+[string strNotes]                   <- if MPF_NOTES
+size_t szCntStudents
+size_t cnt_changes
+student_patch_data[]                <- see StudentPatch::toByteArray()
+
+*/
+        size_t szcbRet = 0;
+
+        //Determine the size needed
+        size_t szcbData =
+            aligned(sizeof(dwFields)) +
+            (dwFields & MPF_YEAR_ESTABLISHED ? aligned(sizeof(nYearEstablished)) : 0) +
+            (dwFields & MPF_NAME ? aligned_sizeof_str(strName) : 0) +
+            (dwFields & MPF_NOTES ? aligned_sizeof_str(strNotes) : 0) +
+            aligned(sizeof(szCntStudents)) +
+            aligned(sizeof(size_t));                //Count of elements in the 'students' array
+
+        for(const StudentPatch& sp : students)
+        {
+            szcbData += sp.toByteArray();
+        }
+
+        //Was the buffer provided?
+        if(pBuff)
+        {
+            //Compare the size provided
+            if(szcbBuff >= szcbData)
+            {
+                //Fill out the buffer
+                uint8_t* pD = (uint8_t*)pBuff;
+                uint8_t* pEnd = pD + szcbData;
+
+                //Clear provided buffer
+                memset(pD, 0, szcbData);
+
+                copy_aligned(pD, dwFields);
+
+                if(dwFields & MPF_YEAR_ESTABLISHED)
+                    copy_aligned(pD, nYearEstablished);
+
+                if(dwFields & MPF_NAME)
+                    copy_aligned_str(pD, strName);
+
+                if(dwFields & MPF_NOTES)
+                    copy_aligned_str(pD, strNotes);
+
+                copy_aligned(pD, szCntStudents);
+
+                //Changes to students
+                size_t szCntChanges = students.size();
+                copy_aligned(pD, szCntChanges);
+
+                for(const StudentPatch& sp : students)
+                {
+                    size_t szcb = sp.toByteArray(pD, pEnd - pD);
+                    if(!szcb)
+                    {
+                        //Failed
+                        assert(false);
+
+#ifdef _WIN32
+                        //Microsoft specific code
+                        __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                        //General case
+                        abort();
+#endif
+                    }
+
+                    pD += szcb;
+                }
+
+
+                //Sanity check
+                if((size_t)(pD - (uint8_t*)pBuff) == szcbData)
+                {
+                    //All done!
+                    szcbRet = szcbData;
+                }
+                else
+                {
+                    //Overflow
+                    assert(false);
+
+#ifdef _WIN32
+                    //Microsoft specific code
+                    __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                    //General case
+                    abort();
+#endif
+                }
+            }
+            else
+                assert(false);
+        }
+        else
+        {
+            //Only needs the size
+            szcbRet = szcbData;
+        }
+
+        return szcbRet;
+    }
+
+
+};
+
+
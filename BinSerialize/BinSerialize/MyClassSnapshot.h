@@ -0,0 +1,461 @@
+// This is a Proof-of-Concept (POC) project that demonstrates
+// secure coding practices when programming binary
+// serialization & de-serialization in C++.
+//
+// Copyright (c) 2023, by dennisbabkin.com
+//
+//
+// This project is used in the following blog post:
+//
+//  "Secure Programming Practices - Serialization"
+//  "Example of secure binary serialization and de-serialization in C++."
+//
+//   https://dennisbabkin.com/blog/?i=AAA12200
+//
+
+
+//Read-only snapshot of MyClass that is shared by many reader threads, and can be
+//replaced with a newly de-serialized version without locking the readers
+//
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "MyClass.h"
+
+
+
+
+//Holds the current snapshot of MyClass, and publishes new ones with an atomic pointer swap (RCU-style).
+//Readers never lock: each reader announces the snapshot it uses in a hazard pointer slot, and a replaced
+//snapshot is deleted only after no hazard pointer refers to it. New versions can be de-serialized
+//with MyClass::fromByteArray() on a background thread, so that reloads don't stall the readers.
+class MyClassSnapshot
+{
+    //How often the background thread tries to delete replaced snapshots that were still in use
+    static constexpr std::chrono::milliseconds RECLAIM_INTERVAL = std::chrono::milliseconds(50);
+
+    //Hazard pointer slot used by one reader at a time
+    struct HAZARD_SLOT
+    {
+        std::atomic<bool> bUsed = false;                    //true if the slot is owned by a Reader
+        std::atomic<const MyClass*> pObj = nullptr;         //Snapshot that the reader uses, or 0 if none
+    };
+
+
+public:
+
+    //Read access to the current snapshot - keeps it alive for as long as this object exists
+    //INFO: Keep it only for a short time, since the old snapshots can't be deleted while it's in use
+    class Reader
+    {
+    public:
+        Reader(Reader&& other) noexcept
+            : _pSlot(other._pSlot)
+            , _pObj(other._pObj)
+        {
+            other._pSlot = nullptr;
+            other._pObj = nullptr;
+        }
+
+        ~Reader()
+        {
+            if(_pSlot)
+            {
+                _pSlot->pObj.store(nullptr, std::memory_order_release);
+                _pSlot->bUsed.store(false, std::memory_order_release);
+            }
+        }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        Reader& operator=(Reader&&) = delete;
+
+
+        /// <summary>
+        /// Returns snapshot, or 0 if nothing was published yet
+        /// </summary>
+        const MyClass* get() const
+        {
+            return _pObj;
+        }
+
+        const MyClass* operator->() const
+        {
+            return _pObj;
+        }
+
+        const MyClass& operator*() const
+        {
+            return *_pObj;
+        }
+
+        explicit operator bool() const
+        {
+            return _pObj != nullptr;
+        }
+
+
+    private:
+        friend class MyClassSnapshot;
+
+        Reader(HAZARD_SLOT* pSlot, const MyClass* pObj)
+            : _pSlot(pSlot)
+            , _pObj(pObj)
+        {
+        }
+
+        HAZARD_SLOT* _pSlot;                                //Hazard pointer slot that protects '_pObj'
+        const MyClass* _pObj;                               //Snapshot in use, or 0 if none
+    };
+
+
+
+
+    /// <summary>
+    /// Creates an empty snapshot holder
+    /// </summary>
+    /// <param name="szMaxReaders">Maximum number of Reader objects that may exist at the same time, others wait for a free slot</param>
+    /// <param name="pLimits">if not 0, limits on resources used by de-serialization - see MyClass::fromByteArray()</param>
+    MyClassSnapshot(size_t szMaxReaders = 64,
+        const DecodeLimits* pLimits = nullptr
+        )
+        : _slots(szMaxReaders ? szMaxReaders : 1)
+    {
+        if(pLimits)
+        {
+            _limits = *pLimits;
+        }
+
+        _thread = std::thread(&MyClassSnapshot::_reloadThread, this);
+    }
+
+
+    ~MyClassSnapshot()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtxReload);
+            _bStop = true;
+        }
+
+        _cvReload.notify_all();
+
+        _thread.join();
+
+        //INFO: All Reader objects must be gone by now
+        delete _pCurrent.load();
+
+        for(const MyClass* pObj : _retired)
+        {
+            delete pObj;
+        }
+    }
+
+
+    MyClassSnapshot(const MyClassSnapshot&) = delete;
+    MyClassSnapshot& operator=(const MyClassSnapshot&) = delete;
+
+
+
+
+    /// <summary>
+    /// Gives read access to the current snapshot, without locking
+    /// INFO: Each Reader takes one of 'szMaxReaders' slots. If all of them are taken, this function spins (yielding
+    ///       the CPU) until one is freed. Thus a thread that holds 'szMaxReaders' Readers and calls read() again never returns!
+    /// </summary>
+    /// <returns>Reader for the current snapshot, that may be empty if nothing was published yet</returns>
+    Reader read()
+    {
+        HAZARD_SLOT* pSlot = _acquireSlot();
+
+        //Announce the snapshot that we're about to use, and make sure that it was
+        //not replaced before the announcement became visible to _reclaim()
+        const MyClass* pObj = _pCurrent.load();
+
+        for(;;)
+        {
+            pSlot->pObj.store(pObj);
+
+            const MyClass* pObjNow = _pCurrent.load();
+            if(pObjNow == pObj)
+                break;
+
+            pObj = pObjNow;
+        }
+
+        return Reader(pSlot, pObj);
+    }
+
+
+
+    /// <summary>
+    /// Replaces the current snapshot with 'pObj', and deletes the old one once no readers use it
+    /// </summary>
+    /// <param name="pObj">New snapshot, or 0 to clear it</param>
+    void publish(std::unique_ptr<MyClass> pObj)
+    {
+        const MyClass* pOld = _pCurrent.exchange(pObj.release());
+
+        {
+            std::lock_guard<std::mutex> lock(_mtxRetire);
+
+            if(pOld)
+            {
+                _retired.push_back(pOld);
+            }
+
+            _reclaim();
+        }
+
+        if(_bHasRetired.load())
+        {
+            //Some are still in use - let the background thread delete them later,
+            //since there may be no more calls to publish()
+            {
+                std::lock_guard<std::mutex> lock(_mtxReload);
+            }
+
+            _cvReload.notify_one();
+        }
+    }
+
+
+
+    /// <summary>
+    /// De-serializes 'pData' on the calling thread, and publishes it if it's valid
+    /// </summary>
+    /// <param name="pData">Serialized byte array, as made by MyClass::toByteArray()</param>
+    /// <param name="szcbData">Size of 'pData' in bytes</param>
+    /// <returns>true if success, false if 'pData' was not valid and the current snapshot was kept</returns>
+    bool reload(const void* pData, size_t szcbData)
+    {
+        std::unique_ptr<MyClass> pObj = std::make_unique<MyClass>();
+
+        //INFO: Don't use lazy de-serialization since the snapshot outlives 'pData'
+        if(pObj->fromByteArray(pData, szcbData, false, _limits ? &*_limits : nullptr) != szcbData)
+        {
+            return false;
+        }
+
+        publish(std::move(pObj));
+
+        return true;
+    }
+
+
+
+    /// <summary>
+    /// De-serializes 'data' on a background thread, and publishes it if it's valid
+    /// INFO: If the previous reload didn't start yet, it is replaced by this one.
+    /// </summary>
+    /// <param name="data">Serialized byte array, as made by MyClass::toByteArray()</param>
+    void reloadAsync(std::vector<uint8_t> data)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtxReload);
+
+            _pending = std::move(data);
+            _bPending = true;
+        }
+
+        _cvReload.notify_one();
+    }
+
+
+
+    /// <summary>
+    /// Waits until all reloads requested with reloadAsync() are finished
+    /// </summary>
+    void waitForReloads()
+    {
+        std::unique_lock<std::mutex> lock(_mtxReload);
+
+        _cvIdle.wait(lock, [this] { return !_bPending && !_bReloading; });
+    }
+
+
+
+    /// <summary>
+    /// Returns number of replaced snapshots that were not deleted yet, because readers may still use them
+    /// </summary>
+    size_t getCountRetired()
+    {
+        std::lock_guard<std::mutex> lock(_mtxRetire);
+
+        return _retired.size();
+    }
+
+
+
+    /// <summary>
+    /// Returns number of reloads that failed because the data was not valid
+    /// </summary>
+    size_t getCountFailedReloads() const
+    {
+        return _szCntFailedReloads.load();
+    }
+
+
+
+private:
+
+    /// <summary>
+    /// Finds a free hazard pointer slot and takes ownership of it
+    /// </summary>
+    HAZARD_SLOT* _acquireSlot()
+    {
+        for(;;)
+        {
+            for(HAZARD_SLOT& slot : _slots)
+            {
+                if(!slot.bUsed.load(std::memory_order_relaxed) &&
+                    !slot.bUsed.exchange(true, std::memory_order_acquire))
+                {
+                    return &slot;
+                }
+            }
+
+            //All slots are in use
+            std::this_thread::yield();
+        }
+    }
+
+
+
+    /// <summary>
+    /// Deletes retired snapshots that are not used by any reader
+    /// INFO: Must be called with '_mtxRetire' locked!
+    /// </summary>
+    void _reclaim()
+    {
+        for(size_t i = 0; i < _retired.size(); )
+        {
+            const MyClass* pObj = _retired[i];
+
+            bool bInUse = false;
+
+            for(const HAZARD_SLOT& slot : _slots)
+            {
+                if(slot.pObj.load() == pObj)
+                {
+                    bInUse = true;
+                    break;
+                }
+            }
+
+            if(bInUse)
+            {
+                //Try again on the next publish()
+                i++;
+            }
+            else
+            {
+                delete pObj;
+
+                _retired[i] = _retired.back();
+                _retired.pop_back();
+            }
+        }
+
+        _bHasRetired.store(!_retired.empty());
+    }
+
+
+
+    /// <summary>
+    /// Thread that de-serializes data passed to reloadAsync()
+    /// </summary>
+    void _reloadThread()
+    {
+        std::vector<uint8_t> data;
+
+        for(;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mtxReload);
+
+                _bReloading = false;
+                _cvIdle.notify_all();
+
+                auto fnHasWork = [this] { return _bStop || _bPending; };
+
+                //Delete replaced snapshots once readers are done with them
+                while(!fnHasWork() &&
+                    _bHasRetired.load())
+                {
+                    if(_cvReload.wait_for(lock, RECLAIM_INTERVAL, fnHasWork))
+                        break;
+
+                    lock.unlock();
+
+                    {
+                        std::lock_guard<std::mutex> lockRetire(_mtxRetire);
+                        _reclaim();
+                    }
+
+                    lock.lock();
+                }
+
+                _cvReload.wait(lock, [this] { return _bStop || _bPending || _bHasRetired.load(); });
+
+                if(_bStop)
+                    break;
+
+                if(!_bPending)
+                {
+                    //Only woken up to delete replaced snapshots
+                    continue;
+                }
+
+                data = std::move(_pending);
+                _pending.clear();
+
+                _bPending = false;
+                _bReloading = true;
+            }
+
+            if(!reload(data.data(), data.size()))
+            {
+                _szCntFailedReloads++;
+            }
+        }
+    }
+
+
+
+
+private:
+
+    std::atomic<const MyClass*> _pCurrent = nullptr;        //Current snapshot, or 0 if none
+
+    std::vector<HAZARD_SLOT> _slots;                        //Hazard pointer slots for readers
+
+    std::mutex _mtxRetire;                                  //Serializes writers in publish() - never used by readers
+    std::vector<const MyClass*> _retired;                   //Replaced snapshots that may still be used by readers
+    std::atomic<bool> _bHasRetired = false;                 //true if '_retired' is not empty
+
+    std::optional<DecodeLimits> _limits;                    //Limits for de-serialization, if used
+
+    std::atomic<size_t> _szCntFailedReloads = 0;            //Number of reloads that failed
+
+    std::mutex _mtxReload;                                  //Protects members below
+    std::condition_variable _cvReload;                      //Signaled when a reload is requested, or when stopping
+    std::condition_variable _cvIdle;                        //Signaled when the reload thread has nothing to do
+    std::vector<uint8_t> _pending;                          //Data for the next reload
+    bool _bPending = false;                                 //true if '_pending' has data for a reload
+    bool _bReloading = true;                                //true while the reload thread is de-serializing
+    bool _bStop = false;                                    //true to stop the reload thread
+
+    std::thread _thread;                                    //Reload thread
+};
+
+
+
+
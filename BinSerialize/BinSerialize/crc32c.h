@@ -0,0 +1,136 @@
+// This is a Proof-of-Concept (POC) project that demonstrates
+// secure coding practices when programming binary
+// serialization & de-serialization in C++.
+//
+// Copyright (c) 2023, by dennisbabkin.com
+//
+//
+// This project is used in the following blog post:
+//
+//  "Secure Programming Practices - Serialization"
+//  "Example of secure binary serialization and de-serialization in C++."
+//
+//   https://dennisbabkin.com/blog/?i=AAA12200
+//
+
+
+//CRC32C (Castagnoli) checksum, with SSE4.2 hardware acceleration
+//
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "simd.h"
+
+
+
+
+/// <summary>
+/// Calculates CRC32C of a byte array, one byte at a time using a lookup table
+/// </summary>
+/// <param name="pData">Byte array</param>
+/// <param name="szcbData">Size of 'pData' in bytes</param>
+/// <param name="nCrc">CRC of the preceding data, or 0 to start</param>
+/// <returns>CRC32C value</returns>
+inline uint32_t crc32c_scalar(const void* pData, size_t szcbData, uint32_t nCrc = 0)
+{
+    static const struct CRC_TABLE
+    {
+        uint32_t v[256];
+
+        CRC_TABLE()
+        {
+            //Reversed Castagnoli polynomial
+            for(uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t c = i;
+                for(int k = 0; k < 8; k++)
+                {
+                    c = (c >> 1) ^ (0x82F63B78 & (0 - (c & 1)));
+                }
+
+                v[i] = c;
+            }
+        }
+    } table;
+
+    const uint8_t* p = (const uint8_t*)pData;
+
+    nCrc = ~nCrc;
+
+    for(size_t i = 0; i < szcbData; i++)
+    {
+        nCrc = table.v[(nCrc ^ p[i]) & 0xFF] ^ (nCrc >> 8);
+    }
+
+    return ~nCrc;
+}
+
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_SSE42
+inline uint32_t crc32c_sse42(const void* pData, size_t szcbData, uint32_t nCrc = 0)
+{
+    const uint8_t* p = (const uint8_t*)pData;
+    const uint8_t* pEnd = p + szcbData;
+
+#if defined(_M_X64) || defined(__x86_64__)
+    //64-bit code
+    uint64_t nCrc64 = ~nCrc;
+
+    for(; pEnd - p >= (intptr_t)sizeof(uint64_t); p += sizeof(uint64_t))
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+
+        nCrc64 = _mm_crc32_u64(nCrc64, v);
+    }
+
+    nCrc = (uint32_t)nCrc64;
+#else
+    //32-bit code
+    nCrc = ~nCrc;
+
+    for(; pEnd - p >= (intptr_t)sizeof(uint32_t); p += sizeof(uint32_t))
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+
+        nCrc = _mm_crc32_u32(nCrc, v);
+    }
+#endif
+
+    for(; p < pEnd; p++)
+    {
+        nCrc = _mm_crc32_u8(nCrc, *p);
+    }
+
+    return ~nCrc;
+}
+
+#endif
+
+
+
+/// <summary>
+/// Calculates CRC32C of a byte array, using SSE4.2 instructions if the CPU supports them
+/// </summary>
+/// <param name="pData">Byte array</param>
+/// <param name="szcbData">Size of 'pData' in bytes</param>
+/// <param name="nCrc">CRC of the preceding data, or 0 to start</param>
+/// <returns>CRC32C value</returns>
+inline uint32_t crc32c(const void* pData, size_t szcbData, uint32_t nCrc = 0)
+{
+#ifdef SIMD_X86
+    if(simd_has_sse42())
+        return crc32c_sse42(pData, szcbData, nCrc);
+#endif
+
+    return crc32c_scalar(pData, szcbData, nCrc);
+}
+
+
+
+
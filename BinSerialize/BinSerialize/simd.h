@@ -0,0 +1,432 @@
+// This is a Proof-of-Concept (POC) project that demonstrates
+// secure coding practices when programming binary
+// serialization & de-serialization in C++.
+//
+// Copyright (c) 2023, by dennisbabkin.com
+//
+//
+// This project is used in the following blog post:
+//
+//  "Secure Programming Practices - Serialization"
+//  "Example of secure binary serialization and de-serialization in C++."
+//
+//   https://dennisbabkin.com/blog/?i=AAA12200
+//
+
+
+//Vectorized validation of columns of primitive types, with runtime dispatch
+//
+#pragma once
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86                    //We can use x86 intrinsics
+#include <immintrin.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define SIMD_SSE2                   //SSE2 is always available, no need to check at runtime
+#endif
+#endif
+
+
+#ifdef _MSC_VER
+#define SIMD_TARGET_AVX2            //Microsoft compiler does not need it
+#define SIMD_TARGET_SSE42
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIMD_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+
+
+
+
+/// <summary>
+/// Checks if AVX2 instructions can be used on this CPU
+/// </summary>
+/// <returns>true if yes</returns>
+inline bool simd_has_avx2()
+{
+#ifdef SIMD_X86
+    static const bool bAvx2 = []()
+    {
+#ifdef _MSC_VER
+        //Microsoft specific code
+        int nRegs[4];
+        __cpuid(nRegs, 0);
+        if(nRegs[0] < 7)
+            return false;
+
+        //Need OSXSAVE and AVX
+        __cpuid(nRegs, 1);
+        if((nRegs[2] & (1 << 27)) == 0 ||
+            (nRegs[2] & (1 << 28)) == 0)
+            return false;
+
+        //OS must save XMM and YMM registers
+        if((_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(nRegs, 7, 0);
+        return (nRegs[1] & (1 << 5)) != 0;
+#else
+        //General case
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }();
+
+    return bAvx2;
+#else
+    return false;
+#endif
+}
+
+
+
+
+
+/// <summary>
+/// Checks if SSE4.2 instructions (including CRC32) can be used on this CPU
+/// </summary>
+/// <returns>true if yes</returns>
+inline bool simd_has_sse42()
+{
+#ifdef SIMD_X86
+    static const bool bSse42 = []()
+    {
+#ifdef _MSC_VER
+        //Microsoft specific code
+        int nRegs[4];
+        __cpuid(nRegs, 1);
+        return (nRegs[2] & (1 << 20)) != 0;
+#else
+        //General case
+        return __builtin_cpu_supports("sse4.2") != 0;
+#endif
+    }();
+
+    return bSse42;
+#else
+    return false;
+#endif
+}
+
+
+
+
+
+/// <summary>
+/// Finds the first 'int' in a column that is not 0 and is outside of [nMin - nMax] range
+/// </summary>
+/// <param name="pCol">Column of 'int' values, may be unaligned</param>
+/// <param name="szCnt">Number of values in 'pCol'</param>
+/// <param name="nMin">Minimum allowed value, inclusive</param>
+/// <param name="nMax">Maximum allowed value, inclusive, must be not less than 'nMin'</param>
+/// <param name="i">Index to start from</param>
+/// <returns>Index of the first invalid value, or 'szCnt' if all are valid</returns>
+inline size_t simd_find_int32_out_of_range_or_zero_scalar(const uint8_t* pCol, size_t szCnt, int nMin, int nMax, size_t i = 0)
+{
+    for(; i < szCnt; i++)
+    {
+        int32_t v;
+        memcpy(&v, pCol + i * sizeof(v), sizeof(v));
+
+        if(v != 0 &&
+            (uint32_t)v - (uint32_t)nMin > (uint32_t)nMax - (uint32_t)nMin)
+        {
+            return i;
+        }
+    }
+
+    return szCnt;
+}
+
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_AVX2
+inline size_t simd_find_int32_out_of_range_or_zero_avx2(const uint8_t* pCol, size_t szCnt, int nMin, int nMax)
+{
+    //Unsigned comparison is done as signed, by flipping the sign bits
+    const __m256i vSign = _mm256_set1_epi32((int)0x80000000);
+    const __m256i vMin = _mm256_set1_epi32(nMin);
+    const __m256i vRange = _mm256_set1_epi32((int)(((uint32_t)nMax - (uint32_t)nMin) ^ 0x80000000));
+    const __m256i vZero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for(; i + 8 <= szCnt; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(pCol + i * sizeof(int32_t)));
+
+        __m256i vOut = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_sub_epi32(v, vMin), vSign), vRange);
+        __m256i vBad = _mm256_andnot_si256(_mm256_cmpeq_epi32(v, vZero), vOut);
+
+        unsigned int nMask = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(vBad));
+        if(nMask)
+        {
+            return i + std::countr_zero(nMask);
+        }
+    }
+
+    return simd_find_int32_out_of_range_or_zero_scalar(pCol, szCnt, nMin, nMax, i);
+}
+
+#endif
+
+
+#ifdef SIMD_SSE2
+
+inline size_t simd_find_int32_out_of_range_or_zero_sse2(const uint8_t* pCol, size_t szCnt, int nMin, int nMax)
+{
+    //Unsigned comparison is done as signed, by flipping the sign bits
+    const __m128i vSign = _mm_set1_epi32((int)0x80000000);
+    const __m128i vMin = _mm_set1_epi32(nMin);
+    const __m128i vRange = _mm_set1_epi32((int)(((uint32_t)nMax - (uint32_t)nMin) ^ 0x80000000));
+    const __m128i vZero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for(; i + 4 <= szCnt; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(pCol + i * sizeof(int32_t)));
+
+        __m128i vOut = _mm_cmpgt_epi32(_mm_xor_si128(_mm_sub_epi32(v, vMin), vSign), vRange);
+        __m128i vBad = _mm_andnot_si128(_mm_cmpeq_epi32(v, vZero), vOut);
+
+        unsigned int nMask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(vBad));
+        if(nMask)
+        {
+            return i + std::countr_zero(nMask);
+        }
+    }
+
+    return simd_find_int32_out_of_range_or_zero_scalar(pCol, szCnt, nMin, nMax, i);
+}
+
+#endif
+
+
+inline size_t simd_find_int32_out_of_range_or_zero(const uint8_t* pCol, size_t szCnt, int nMin, int nMax)
+{
+#ifdef SIMD_X86
+    if(simd_has_avx2())
+        return simd_find_int32_out_of_range_or_zero_avx2(pCol, szCnt, nMin, nMax);
+#endif
+
+#ifdef SIMD_SSE2
+    return simd_find_int32_out_of_range_or_zero_sse2(pCol, szCnt, nMin, nMax);
+#else
+    return simd_find_int32_out_of_range_or_zero_scalar(pCol, szCnt, nMin, nMax);
+#endif
+}
+
+
+
+
+
+/// <summary>
+/// Finds the first 'uint32_t' in a column that is not less than 'nLimit'
+/// </summary>
+/// <param name="pCol">Column of 'uint32_t' values, may be unaligned</param>
+/// <param name="szCnt">Number of values in 'pCol'</param>
+/// <param name="nLimit">Values must be less than this, must be above 0</param>
+/// <param name="i">Index to start from</param>
+/// <returns>Index of the first invalid value, or 'szCnt' if all are valid</returns>
+inline size_t simd_find_uint32_not_below_scalar(const uint8_t* pCol, size_t szCnt, uint32_t nLimit, size_t i = 0)
+{
+    for(; i < szCnt; i++)
+    {
+        uint32_t v;
+        memcpy(&v, pCol + i * sizeof(v), sizeof(v));
+
+        if(v >= nLimit)
+        {
+            return i;
+        }
+    }
+
+    return szCnt;
+}
+
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_AVX2
+inline size_t simd_find_uint32_not_below_avx2(const uint8_t* pCol, size_t szCnt, uint32_t nLimit)
+{
+    //Unsigned comparison is done as signed, by flipping the sign bits
+    const __m256i vSign = _mm256_set1_epi32((int)0x80000000);
+    const __m256i vMax = _mm256_set1_epi32((int)((nLimit - 1) ^ 0x80000000));
+
+    size_t i = 0;
+    for(; i + 8 <= szCnt; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(pCol + i * sizeof(uint32_t)));
+
+        __m256i vBad = _mm256_cmpgt_epi32(_mm256_xor_si256(v, vSign), vMax);
+
+        unsigned int nMask = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(vBad));
+        if(nMask)
+        {
+            return i + std::countr_zero(nMask);
+        }
+    }
+
+    return simd_find_uint32_not_below_scalar(pCol, szCnt, nLimit, i);
+}
+
+#endif
+
+
+#ifdef SIMD_SSE2
+
+inline size_t simd_find_uint32_not_below_sse2(const uint8_t* pCol, size_t szCnt, uint32_t nLimit)
+{
+    //Unsigned comparison is done as signed, by flipping the sign bits
+    const __m128i vSign = _mm_set1_epi32((int)0x80000000);
+    const __m128i vMax = _mm_set1_epi32((int)((nLimit - 1) ^ 0x80000000));
+
+    size_t i = 0;
+    for(; i + 4 <= szCnt; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(pCol + i * sizeof(uint32_t)));
+
+        __m128i vBad = _mm_cmpgt_epi32(_mm_xor_si128(v, vSign), vMax);
+
+        unsigned int nMask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(vBad));
+        if(nMask)
+        {
+            return i + std::countr_zero(nMask);
+        }
+    }
+
+    return simd_find_uint32_not_below_scalar(pCol, szCnt, nLimit, i);
+}
+
+#endif
+
+
+inline size_t simd_find_uint32_not_below(const uint8_t* pCol, size_t szCnt, uint32_t nLimit)
+{
+#ifdef SIMD_X86
+    if(simd_has_avx2())
+        return simd_find_uint32_not_below_avx2(pCol, szCnt, nLimit);
+#endif
+
+#ifdef SIMD_SSE2
+    return simd_find_uint32_not_below_sse2(pCol, szCnt, nLimit);
+#else
+    return simd_find_uint32_not_below_scalar(pCol, szCnt, nLimit);
+#endif
+}
+
+
+
+
+
+/// <summary>
+/// Finds the first 'double' in a column that is infinity or NaN
+/// </summary>
+/// <param name="pCol">Column of 'double' values, may be unaligned</param>
+/// <param name="szCnt">Number of values in 'pCol'</param>
+/// <param name="i">Index to start from</param>
+/// <returns>Index of the first invalid value, or 'szCnt' if all are valid</returns>
+inline size_t simd_find_nonfinite_double_scalar(const uint8_t* pCol, size_t szCnt, size_t i = 0)
+{
+    static_assert(sizeof(double) == sizeof(uint64_t), "Expected IEEE 754 double");
+
+    for(; i < szCnt; i++)
+    {
+        //All exponent bits set means infinity or NaN
+        uint64_t v;
+        memcpy(&v, pCol + i * sizeof(v), sizeof(v));
+
+        if((v & 0x7FF0000000000000ull) == 0x7FF0000000000000ull)
+        {
+            return i;
+        }
+    }
+
+    return szCnt;
+}
+
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_AVX2
+inline size_t simd_find_nonfinite_double_avx2(const uint8_t* pCol, size_t szCnt)
+{
+    const __m256i vExp = _mm256_set1_epi64x(0x7FF0000000000000ll);
+
+    size_t i = 0;
+    for(; i + 4 <= szCnt; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(pCol + i * sizeof(double)));
+
+        __m256i vBad = _mm256_cmpeq_epi64(_mm256_and_si256(v, vExp), vExp);
+
+        unsigned int nMask = (unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(vBad));
+        if(nMask)
+        {
+            return i + std::countr_zero(nMask);
+        }
+    }
+
+    return simd_find_nonfinite_double_scalar(pCol, szCnt, i);
+}
+
+#endif
+
+
+#ifdef SIMD_SSE2
+
+inline size_t simd_find_nonfinite_double_sse2(const uint8_t* pCol, size_t szCnt)
+{
+    //SSE2 has no 64-bit compare, but all exponent bits are in the upper 32 bits of each double
+    const __m128i vExp = _mm_set1_epi64x(0x7FF0000000000000ll);
+
+    size_t i = 0;
+    for(; i + 2 <= szCnt; i += 2)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(pCol + i * sizeof(double)));
+
+        __m128i vBad = _mm_cmpeq_epi32(_mm_and_si128(v, vExp), vExp);
+
+        //Take results from the upper 32 bits only: bits 1 and 3
+        unsigned int nMask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(vBad)) & 0xA;
+        if(nMask)
+        {
+            return i + std::countr_zero(nMask) / 2;
+        }
+    }
+
+    return simd_find_nonfinite_double_scalar(pCol, szCnt, i);
+}
+
+#endif
+
+
+inline size_t simd_find_nonfinite_double(const uint8_t* pCol, size_t szCnt)
+{
+#ifdef SIMD_X86
+    if(simd_has_avx2())
+        return simd_find_nonfinite_double_avx2(pCol, szCnt);
+#endif
+
+#ifdef SIMD_SSE2
+    return simd_find_nonfinite_double_sse2(pCol, szCnt);
+#else
+    return simd_find_nonfinite_double_scalar(pCol, szCnt);
+#endif
+}
+
+
+
+
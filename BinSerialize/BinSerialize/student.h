@@ -18,10 +18,17 @@
 #pragma once
 
 #include <string>
+#include <type_traits>
+#include <vector>
 #include <assert.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 #include "types.h"
+#include "simd.h"
 
 
 
@@ -42,10 +49,32 @@ enum class AttendanceType : unsigned int
 
 
 
+//Fixed-size fields of the 'Student' struct, as reported by Student::scanByteArray()
+struct StudentFixedFields
+{
+    int nAge = 0;
+    AttendanceType attendance = AttendanceType::Unknown;
+    bool bSuspended = false;
+    double fPerformanceScore = 0.0;
+};
+
+
+
 
 
 struct Student
 {
+    //Number of name fields that are replaced with indexes in the dictionary encoding
+    static constexpr size_t CNT_DICT_NAMES = 3;
+
+private:
+
+    //INFO: Members are private, so that they can't be changed without dropping bytes kept by cache().
+    //      Encoders and decoders of the whole class and of patches access them directly.
+    friend struct MyClass;
+    friend struct StudentPatch;
+    friend struct MyClassPatch;
+
     //Age of the person, or 0 if not known
     //[MIN_ALLOWED_AGE - MAX_ALLOWED_AGE] acceptable range
     int nAge = 0;
@@ -72,7 +101,14 @@ struct Student
     double fPerformanceScore = 0.0;
 
     //Internal notes about the student
-    std::string strNotes;
+    //INFO: It refers to the original byte array, if it was de-serialized lazily
+    LazyOrOwnedStr strNotes;
+
+    //Serialized bytes of this struct, if they were cached by cache(), or empty if not
+    //INFO: Call invalidate() after changing any of the members above
+    std::vector<uint8_t> cachedBytes;
+
+public:
 
 
 
@@ -97,15 +133,306 @@ struct Student
 
 
 
+    int getAge() const
+    {
+        return nAge;
+    }
+
+    const std::string& getGivenName() const
+    {
+        return strGivenName;
+    }
+
+    const std::string& getSecondName() const
+    {
+        return strSecondName;
+    }
+
+    const std::string& getThirdName() const
+    {
+        return strThirdName;
+    }
+
+    AttendanceType getAttendance() const
+    {
+        return attendance;
+    }
+
+    bool isSuspended() const
+    {
+        return bSuspended;
+    }
+
+    double getPerformanceScore() const
+    {
+        return fPerformanceScore;
+    }
+
+
+
+    /// <summary>
+    /// Returns 'strNotes', and copies it out of the original byte array, if it was de-serialized lazily
+    /// </summary>
+    /// <returns>Notes about the student</returns>
+    const std::string& getNotes()
+    {
+        return strNotes.get();
+    }
+
+
+    /// <summary>
+    /// Returns 'strNotes' without copying it, even if it was de-serialized lazily
+    /// </summary>
+    /// <returns>View of the notes, valid until this struct is modified</returns>
+    std::string_view getNotesView() const
+    {
+        return strNotes.view();
+    }
+
+
+    /// <summary>
+    /// Sets 'strNotes', drops the reference to the original byte array, if it was de-serialized lazily, and drops bytes kept by cache()
+    /// </summary>
+    /// <param name="notes">New notes</param>
+    void setNotes(std::string_view notes)
+    {
+        strNotes.set(notes);
+
+        invalidate();
+    }
+
+
+    /// <summary>
+    /// Sets 'nAge', and drops bytes kept by cache()
+    /// </summary>
+    void setAge(int age)
+    {
+        nAge = age;
+        invalidate();
+    }
+
+
+    /// <summary>
+    /// Sets 'strGivenName', and drops bytes kept by cache()
+    /// </summary>
+    void setGivenName(std::string_view givenName)
+    {
+        strGivenName.assign(givenName);
+        invalidate();
+    }
+
+
+    /// <summary>
+    /// Sets 'strSecondName', and drops bytes kept by cache()
+    /// </summary>
+    void setSecondName(std::string_view secondName)
+    {
+        strSecondName.assign(secondName);
+        invalidate();
+    }
+
+
+    /// <summary>
+    /// Sets 'strThirdName', and drops bytes kept by cache()
+    /// </summary>
+    void setThirdName(std::string_view thirdName)
+    {
+        strThirdName.assign(thirdName);
+        invalidate();
+    }
+
+
+    /// <summary>
+    /// Sets all names, and drops bytes kept by cache()
+    /// </summary>
+    void setNames(std::string_view givenName, std::string_view secondName = {}, std::string_view thirdName = {})
+    {
+        strGivenName.assign(givenName);
+        strSecondName.assign(secondName);
+        strThirdName.assign(thirdName);
+
+        invalidate();
+    }
+
+
+    /// <summary>
+    /// Sets 'attendance', and drops bytes kept by cache()
+    /// </summary>
+    void setAttendance(AttendanceType attend)
+    {
+        attendance = attend;
+        invalidate();
+    }
+
+
+    /// <summary>
+    /// Sets 'bSuspended', and drops bytes kept by cache()
+    /// </summary>
+    void setSuspended(bool suspended)
+    {
+        bSuspended = suspended;
+        invalidate();
+    }
+
+
+    /// <summary>
+    /// Sets 'fPerformanceScore', and drops bytes kept by cache()
+    /// </summary>
+    void setPerformanceScore(double score)
+    {
+        fPerformanceScore = score;
+        invalidate();
+    }
+
+
+
+    /// <summary>
+    /// Serializes this struct and keeps the result, so that toByteArray() only needs to copy it
+    /// INFO: Use it for students that don't change often, since it doubles memory used by this struct.
+    /// </summary>
+    /// <returns>true if success</returns>
+    bool cache()
+    {
+        invalidate();
+
+        std::vector<uint8_t> bytes(toByteArray());
+
+        if(bytes.empty() ||
+            toByteArray(bytes.data(), bytes.size()) != bytes.size())
+        {
+            return false;
+        }
+
+        cachedBytes = std::move(bytes);
+
+        return true;
+    }
+
+
+    /// <summary>
+    /// Drops serialized bytes kept by cache() - setters call it, and so must the code that changes members directly
+    /// </summary>
+    void invalidate()
+    {
+        cachedBytes.clear();
+    }
+
+
+    /// <summary>
+    /// Returns true if serialized bytes were kept by cache()
+    /// </summary>
+    bool isCached() const
+    {
+        return !cachedBytes.empty();
+    }
+
+
+
+
+    /// <summary>
+    /// Returns the smallest possible size of a serialized student, with all strings empty
+    /// </summary>
+    /// <returns>Size in bytes</returns>
+    static size_t getMinByteArraySize()
+    {
+        return aligned(sizeof(nAge)) +
+            aligned(sizeof(size_t)) * 4 +           //Lengths of 'strGivenName', 'strSecondName', 'strThirdName', 'strNotes'
+            aligned(sizeof(attendance)) +
+            aligned(sizeof(bSuspended)) +
+            aligned(sizeof(fPerformanceScore));
+    }
+
+
+    /// <summary>
+    /// Checks if 'nAge' value is within the acceptable range
+    /// </summary>
+    /// <param name="nAge">Age to check</param>
+    /// <returns>true if valid</returns>
+    static bool isValidAge(int nAge)
+    {
+        if(nAge != 0)
+        {
+            if(nAge < MIN_ALLOWED_AGE ||
+                nAge > MAX_ALLOWED_AGE)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    /// <summary>
+    /// Checks if 'attendance' value is within the acceptable range
+    /// </summary>
+    /// <param name="attendance">Attendance type to check</param>
+    /// <returns>true if valid</returns>
+    static bool isValidAttendance(AttendanceType attendance)
+    {
+        return attendance >= AttendanceType::Unknown &&
+            attendance < AttendanceType::MaxCount;
+    }
+
+
+
+    /// <summary>
+    /// Finds the first invalid value in a column of 'nAge' values, as stored in the columnar encoding
+    /// </summary>
+    /// <param name="pCol">Column of 'int' values, may be unaligned</param>
+    /// <param name="szCnt">Number of values in 'pCol'</param>
+    /// <returns>Index of the first invalid value, or 'szCnt' if all are valid</returns>
+    static size_t findInvalidAgeInColumn(const uint8_t* pCol, size_t szCnt)
+    {
+        static_assert(sizeof(nAge) == sizeof(int32_t), "Column kernel expects 32-bit values");
+
+        return simd_find_int32_out_of_range_or_zero(pCol, szCnt, MIN_ALLOWED_AGE, MAX_ALLOWED_AGE);
+    }
+
+
+    /// <summary>
+    /// Finds the first invalid value in a column of 'attendance' values, as stored in the columnar encoding
+    /// </summary>
+    /// <param name="pCol">Column of 'AttendanceType' values, may be unaligned</param>
+    /// <param name="szCnt">Number of values in 'pCol'</param>
+    /// <returns>Index of the first invalid value, or 'szCnt' if all are valid</returns>
+    static size_t findInvalidAttendanceInColumn(const uint8_t* pCol, size_t szCnt)
+    {
+        static_assert(std::is_same_v<std::underlying_type_t<AttendanceType>, unsigned int> &&
+            sizeof(unsigned int) == sizeof(uint32_t), "Column kernel expects 32-bit unsigned values");
+
+        return simd_find_uint32_not_below(pCol, szCnt, (uint32_t)AttendanceType::MaxCount);
+    }
+
+
+    /// <summary>
+    /// Finds the first invalid value in a column of 'fPerformanceScore' values, as stored in the columnar encoding
+    /// </summary>
+    /// <param name="pCol">Column of 'double' values, may be unaligned</param>
+    /// <param name="szCnt">Number of values in 'pCol'</param>
+    /// <returns>Index of the first value that is not finite, or 'szCnt' if all are valid</returns>
+    static size_t findInvalidScoreInColumn(const uint8_t* pCol, size_t szCnt)
+    {
+        return simd_find_nonfinite_double(pCol, szCnt);
+    }
+
+
+
 
     /// <summary>
     /// De-serializes byte array into this struct
     /// </summary>
     /// <param name="pData">Byte array to convert</param>
     /// <param name="szcbData">Size of 'pData' in bytes</param>
+    /// <param name="bLazyNotes">true to only check 'strNotes' for bounds and keep a reference to it in 'pData' instead of copying it,
+    ///                          in that case 'pData' must remain valid until getNotes() is called, or this struct is modified</param>
+    /// <param name="pBudget">if not 0, resources used by this de-serialization call, to check against its limits and update</param>
     /// <returns>[1 and up) if success, for amount of bytes used, 0 if error - in this case this struct will be reset</returns>
-    size_t fromByteArray(const void* pData, size_t szcbData)
+    size_t fromByteArray(const void* pData, size_t szcbData, bool bLazyNotes = false, DecodeBudget* pBudget = nullptr)
     {
+        //Members will change
+        invalidate();
+
         while(true)
         {
             //Do we have a pointer to data?
@@ -133,18 +460,12 @@ struct Student
             if(!read_aligned(pS, pEnd, nAge))
                 break;
 
-            if(nAge != 0)
-            {
-                if(nAge < MIN_ALLOWED_AGE ||
-                    nAge > MAX_ALLOWED_AGE)
-                {
-                    break;
-                }
-            }
+            if(!isValidAge(nAge))
+                break;
 
 
             //Check 'strGivenName'
-            if(!read_aligned_str(pS, pEnd, strGivenName, MAX_NAME_LEN_1))
+            if(!read_aligned_str(pS, pEnd, strGivenName, MAX_NAME_LEN_1, pBudget))
                 break;
 
             if(strGivenName.empty())
@@ -152,12 +473,12 @@ struct Student
 
 
             //Check 'strSecondName'
-            if(!read_aligned_str(pS, pEnd, strSecondName, MAX_NAME_LEN_1))
+            if(!read_aligned_str(pS, pEnd, strSecondName, MAX_NAME_LEN_1, pBudget))
                 break;
 
 
             //Check 'strThirdName'
-            if(!read_aligned_str(pS, pEnd, strThirdName, MAX_NAME_LEN_1))
+            if(!read_aligned_str(pS, pEnd, strThirdName, MAX_NAME_LEN_1, pBudget))
                 break;
 
 
@@ -165,19 +486,15 @@ struct Student
             if(!read_aligned(pS, pEnd, attendance))
                 break;
 
-            if(attendance < AttendanceType::Unknown ||
-                attendance >= AttendanceType::MaxCount)
+            if(!isValidAttendance(attendance))
                 break;
 
 
             //Check 'bSuspended'
+            //read_aligned() accepts only 0 or 1 for a bool
             if(!read_aligned(pS, pEnd, bSuspended))
                 break;
 
-            if(bSuspended != true &&
-                bSuspended != false)
-                break;
-
 
             //Check 'fPerformanceScore'
             if(!read_aligned_double(pS, pEnd, fPerformanceScore))
@@ -185,8 +502,19 @@ struct Student
 
 
             //Check 'strNotes'
-            if(!read_aligned_str(pS, pEnd, strNotes, 0))
-                break;
+            if(bLazyNotes)
+            {
+                LazyStr lzNotes;
+                if(!read_aligned_str_lazy(pS, pEnd, lzNotes, 0))
+                    break;
+
+                strNotes.setLazy(lzNotes);
+            }
+            else
+            {
+                if(!read_aligned_str(pS, pEnd, strNotes.owned(), 0, pBudget))
+                    break;
+            }
 
 
             //Sanity check
@@ -205,7 +533,7 @@ struct Student
                 __fastfail(FAST_FAIL_FATAL_APP_EXIT);
 #else
                 //General case
-                abort(-1);
+                abort();
 #endif
             }
 
@@ -223,6 +551,116 @@ struct Student
 
 
 
+    /// <summary>
+    /// Validates a serialized student in a byte array without allocating its strings.
+    /// String fields are checked for bounds and length and then skipped over.
+    /// </summary>
+    /// <param name="pData">Byte array to scan</param>
+    /// <param name="szcbData">Size of 'pData' in bytes</param>
+    /// <param name="fields">Receives fixed-size fields of the student, if success</param>
+    /// <returns>[1 and up) if success, for amount of bytes used, 0 if error</returns>
+    static size_t scanByteArray(const void* pData, size_t szcbData, StudentFixedFields& fields)
+    {
+        while(true)
+        {
+            //Do we have a pointer to data?
+            if(!pData)
+                break;
+
+            //Check overall data size provided
+            if((intptr_t)szcbData <= 0)
+                break;
+
+            const uint8_t* pS = (const uint8_t*)pData;
+            const uint8_t* pEnd = pS + szcbData;
+            assert(pEnd > pS);
+
+            StudentFixedFields f;
+
+
+            //Check 'nAge'
+            if(!read_aligned(pS, pEnd, f.nAge))
+                break;
+
+            if(!isValidAge(f.nAge))
+                break;
+
+
+            //Check 'strGivenName'
+            size_t szchGivenName;
+            if(!skip_aligned_str(pS, pEnd, MAX_NAME_LEN_1, &szchGivenName))
+                break;
+
+            if(szchGivenName == 0)
+                break;
+
+
+            //Check 'strSecondName'
+            if(!skip_aligned_str(pS, pEnd, MAX_NAME_LEN_1))
+                break;
+
+
+            //Check 'strThirdName'
+            if(!skip_aligned_str(pS, pEnd, MAX_NAME_LEN_1))
+                break;
+
+
+            //Check 'attendance'
+            if(!read_aligned(pS, pEnd, f.attendance))
+                break;
+
+            if(!isValidAttendance(f.attendance))
+                break;
+
+
+            //Check 'bSuspended'
+            //read_aligned() accepts only 0 or 1 for a bool
+            if(!read_aligned(pS, pEnd, f.bSuspended))
+                break;
+
+
+            //Check 'fPerformanceScore'
+            if(!read_aligned_double(pS, pEnd, f.fPerformanceScore))
+                break;
+
+
+            //Check 'strNotes'
+            if(!skip_aligned_str(pS, pEnd, 0))
+                break;
+
+
+            //Sanity check
+            if(pS <= pEnd)
+            {
+                //Success!
+                fields = f;
+
+                return pS - (const uint8_t*)pData;
+            }
+            else
+            {
+                //Overflow
+                assert(false);
+
+#ifdef _WIN32
+                //Microsoft specific code
+                __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                //General case
+                abort();
+#endif
+            }
+
+
+            break;
+        }
+
+        //Failed
+        return 0;
+    }
+
+
+
 
 
     /// <summary>
@@ -236,7 +674,7 @@ struct Student
         size_t szcbRet = 0;
 
         //Determine the size needed
-        size_t szcbData = 
+        size_t szcbData = isCached() ? cachedBytes.size() :
             aligned(sizeof(nAge)) +
             aligned_sizeof_str(strGivenName) +
             aligned_sizeof_str(strSecondName) +
@@ -244,7 +682,224 @@ struct Student
             aligned(sizeof(attendance)) +
             aligned(sizeof(bSuspended)) +
             aligned(sizeof(fPerformanceScore)) +
-            aligned_sizeof_str(strNotes);
+            aligned_sizeof_str(getNotesView());
+
+        //Was the buffer provided?
+        if(pBuff)
+        {
+            //Compare the size provided
+            if(szcbBuff >= szcbData)
+            {
+                //Fill out the buffer
+                uint8_t* pD = (uint8_t*)pBuff;
+
+                if(isCached())
+                {
+                    //Nothing changed since cache()
+                    memcpy(pD, cachedBytes.data(), szcbData);
+                    pD += szcbData;
+                }
+                else
+                {
+                    //Clear provided buffer
+                    memset(pD, 0, szcbData);
+
+                    copy_aligned(pD, nAge);
+
+                    copy_aligned_str(pD, strGivenName);
+                    copy_aligned_str(pD, strSecondName);
+                    copy_aligned_str(pD, strThirdName);
+
+                    copy_aligned(pD, attendance);
+                    copy_aligned(pD, bSuspended);
+                    copy_aligned(pD, fPerformanceScore);
+
+                    copy_aligned_str(pD, getNotesView());
+                }
+
+
+                //Sanity check
+                if((size_t)(pD - (uint8_t*)pBuff) == szcbData)
+                {
+                    //All done!
+                    szcbRet = szcbData;
+                }
+                else
+                {
+                    //Overflow
+                    assert(false);
+
+#ifdef _WIN32
+                    //Microsoft specific code
+                    __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                    //General case
+                    abort();
+#endif
+                }
+            }
+            else
+                assert(false);
+        }
+        else
+        {
+            //Only needs the size
+            szcbRet = szcbData;
+        }
+
+        return szcbRet;
+    }
+
+
+
+
+
+    /// <summary>
+    /// De-serializes byte array produced by toByteArrayDict() into this struct
+    /// </summary>
+    /// <param name="pData">Byte array to convert</param>
+    /// <param name="szcbData">Size of 'pData' in bytes</param>
+    /// <param name="strTable">Table of strings that name indexes refer to, its strings must have been already validated for MAX_NAME_LEN_1</param>
+    /// <param name="pBudget">if not 0, resources used by this de-serialization call, to check against its limits and update.
+    ///                       INFO: Names are copied out of 'strTable', so they may take much more memory than 'pData' itself!</param>
+    /// <returns>[1 and up) if success, for amount of bytes used, 0 if error - in this case this struct will be reset</returns>
+    size_t fromByteArrayDict(const void* pData, size_t szcbData, const std::vector<std::string>& strTable, DecodeBudget* pBudget = nullptr)
+    {
+        //Members will change
+        invalidate();
+
+        while(true)
+        {
+            //Do we have a pointer to data?
+            if(!pData)
+                break;
+
+            //Check overall data size provided
+            if((intptr_t)szcbData <= 0)
+                break;
+
+            const uint8_t* pS = (const uint8_t*)pData;
+            const uint8_t* pEnd = pS + szcbData;
+            assert(pEnd > pS);
+
+
+            //Check 'nAge'
+            if(!read_aligned(pS, pEnd, nAge))
+                break;
+
+            if(!isValidAge(nAge))
+                break;
+
+
+            //Check indexes for 'strGivenName', 'strSecondName', 'strThirdName'
+            const uint8_t* pIdxNames;
+            if(!read_aligned_array_ptr<uint32_t>(pS, pEnd, CNT_DICT_NAMES, pIdxNames))
+                break;
+
+            uint32_t idxNames[CNT_DICT_NAMES];
+            memcpy(idxNames, pIdxNames, sizeof(idxNames));
+
+            if(idxNames[0] >= strTable.size() ||
+                idxNames[1] >= strTable.size() ||
+                idxNames[2] >= strTable.size())
+                break;
+
+            if(strTable[idxNames[0]].empty())
+                break;
+
+            if(pBudget)
+            {
+                if(!pBudget->addString(strTable[idxNames[0]].size()) ||
+                    !pBudget->addString(strTable[idxNames[1]].size()) ||
+                    !pBudget->addString(strTable[idxNames[2]].size()))
+                    break;
+            }
+
+            strGivenName = strTable[idxNames[0]];
+            strSecondName = strTable[idxNames[1]];
+            strThirdName = strTable[idxNames[2]];
+
+
+            //Check 'attendance'
+            if(!read_aligned(pS, pEnd, attendance))
+                break;
+
+            if(!isValidAttendance(attendance))
+                break;
+
+
+            //Check 'bSuspended'
+            //read_aligned() accepts only 0 or 1 for a bool
+            if(!read_aligned(pS, pEnd, bSuspended))
+                break;
+
+
+            //Check 'fPerformanceScore'
+            if(!read_aligned_double(pS, pEnd, fPerformanceScore))
+                break;
+
+
+            //Check 'strNotes'
+            if(!read_aligned_str(pS, pEnd, strNotes.owned(), 0, pBudget))
+                break;
+
+
+            //Sanity check
+            if(pS <= pEnd)
+            {
+                //Success!
+                return pS - (const uint8_t*)pData;
+            }
+            else
+            {
+                //Overflow
+                assert(false);
+
+#ifdef _WIN32
+                //Microsoft specific code
+                __fastfail(FAST_FAIL_FATAL_APP_EXIT);
+#else
+                //General case
+                abort();
+#endif
+            }
+
+
+            break;
+        }
+
+        //Failure to de-serialize
+
+        //Reset this struct
+        *this = Student();
+
+        return 0;
+    }
+
+
+
+
+
+    /// <summary>
+    /// Serializes this struct by converting it to a byte array, where the names are replaced
+    /// with indexes into a table of strings, that is stored separately by the caller
+    /// </summary>
+    /// <param name="pIdxNames">CNT_DICT_NAMES indexes of 'strGivenName', 'strSecondName' and 'strThirdName' in the table of strings</param>
+    /// <param name="pBuff">if not 0, pointer to the buffer to fill out</param>
+    /// <param name="szcbBuff">Size of provided 'pBuff' in bytes</param>
+    /// <returns>Size of the filled (or needed to fill) buffer in bytes, or 0 if error</returns>
+    size_t toByteArrayDict(const uint32_t* pIdxNames, void* pBuff = nullptr, size_t szcbBuff = 0) const
+    {
+        size_t szcbRet = 0;
+
+        //Determine the size needed
+        size_t szcbData = 
+            aligned(sizeof(nAge)) +
+            aligned_sizeof_array<uint32_t>(CNT_DICT_NAMES) +
+            aligned(sizeof(attendance)) +
+            aligned(sizeof(bSuspended)) +
+            aligned(sizeof(fPerformanceScore)) +
+            aligned_sizeof_str(getNotesView());
 
         //Was the buffer provided?
         if(pBuff)
@@ -260,19 +915,17 @@ struct Student
 
                 copy_aligned(pD, nAge);
 
-                copy_aligned_str(pD, strGivenName);
-                copy_aligned_str(pD, strSecondName);
-                copy_aligned_str(pD, strThirdName);
+                copy_aligned_array(pD, pIdxNames, CNT_DICT_NAMES);
 
                 copy_aligned(pD, attendance);
                 copy_aligned(pD, bSuspended);
                 copy_aligned(pD, fPerformanceScore);
 
-                copy_aligned_str(pD, strNotes);
+                copy_aligned_str(pD, getNotesView());
 
 
                 //Sanity check
-                if(pD - (uint8_t*)pBuff == szcbData)
+                if((size_t)(pD - (uint8_t*)pBuff) == szcbData)
                 {
                     //All done!
                     szcbRet = szcbData;
@@ -287,7 +940,7 @@ struct Student
                     __fastfail(FAST_FAIL_FATAL_APP_EXIT);
 #else
                     //General case
-                    abort(-1);
+                    abort();
 #endif
                 }
             }
@@ -17,15 +17,21 @@
 //Custom declarations
 #pragma once
 
-#include <intrin.h>
-
+#include <array>
+#include <bit>
 #include <cmath>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 
 
 
 #define ALIGN_BY (sizeof(void*))    //Align by this number of bytes, or comment out to remove alignment
-#define STR_CHAR char               //Type of characters in the STL strings
 
 
 #define MIN_ALLOWED_AGE 10          //Inclusive
@@ -80,18 +86,41 @@ inline T aligned(T n)
 /// <summary>
 /// Calculates size of STL string taking alignment into account
 /// </summary>
-/// <typeparam name="s">STL string</typeparam>
+/// <typeparam name="s">STL string, or string view - the type of its characters is taken from it</typeparam>
 /// <returns>Aligned size</returns>
 template<class T>
-inline size_t aligned_sizeof_str(T& s)
+inline size_t aligned_sizeof_str(const T& s)
 {
     /*
     size_t length;
-    char[] str;
+    CH[] str;
     */
 
+    using CH = typename T::value_type;
+
     return aligned(sizeof(size_t)) +
-        aligned(s.size() * sizeof(STR_CHAR));
+        aligned(s.size() * sizeof(CH));
+}
+
+
+
+/// <summary>
+/// Checks if an array of primitive types, together with its alignment padding, fits into the byte array
+/// INFO: The padding must be checked as well. Otherwise an unpadded array at the very end of the byte array
+///       would pass the check, and the reader would then advance past 'pEnd'.
+/// </summary>
+/// <param name="p">Pointer to byte array to read from</param>
+/// <param name="pEnd">End of the byte array, exclusive</param>
+/// <param name="szCnt">Number of elements in the array</param>
+/// <returns>true if it fits, false if it would overrun 'pEnd'</returns>
+template<class T>
+inline bool fits_aligned_array(const uint8_t* p, const uint8_t* pEnd, size_t szCnt)
+{
+    //Compare against what's left, so that we never overflow
+    size_t szcbLeft = (size_t)(pEnd - p);
+
+    return szCnt <= szcbLeft / sizeof(T) &&
+        aligned(szCnt * sizeof(T)) <= szcbLeft;
 }
 
 
@@ -104,7 +133,11 @@ inline size_t aligned_sizeof_str(T& s)
 template<class T>
 inline void copy_aligned(uint8_t*& p, T s)
 {
-    *(T*)p = s;
+    static_assert(std::is_trivially_copyable_v<T>, "Only primitive types can be copied");
+
+    //INFO: 'p' may not be aligned for T, and casting it to T* breaks strict aliasing.
+    //      Compilers turn memcpy of a known size into a single move instruction.
+    memcpy(p, &s, sizeof(s));
     p += aligned(sizeof(s));
 
 }
@@ -112,20 +145,21 @@ inline void copy_aligned(uint8_t*& p, T s)
 
 
 /// <summary>
-/// Copy STL string into a memory location
+/// Copy STL string (or string view) into a memory location
 /// </summary>
 /// <param name="p">Pointer to the memory location. It will be incremented by the sizeof string</param>
-/// <param name="s">STL string to copy</param>
+/// <param name="s">STL string to copy - the type of its characters is taken from it</param>
 template<class T>
-inline void copy_aligned_str(uint8_t*& p, T& s)
+inline void copy_aligned_str(uint8_t*& p, const T& s)
 {
+    using CH = typename T::value_type;
+
     size_t szStr = s.size();
 
-    *(size_t*)p = szStr;
-    p += aligned(sizeof(szStr));
+    copy_aligned(p, szStr);
 
-    memcpy(p, s.c_str(), szStr * sizeof(STR_CHAR));
-    p += aligned(szStr * sizeof(STR_CHAR));
+    memcpy(p, s.data(), szStr * sizeof(CH));
+    p += aligned(szStr * sizeof(CH));
 
 }
 
@@ -143,15 +177,48 @@ inline void copy_aligned_str(uint8_t*& p, T& s)
 template<class T>
 inline bool read_aligned(const uint8_t*& p, const uint8_t* pEnd, T& s)
 {
-    intptr_t szcb = aligned(sizeof(s));
-    if(p + szcb > pEnd)
+    if(!fits_aligned_array<T>(p, pEnd, 1))
     {
         //Overrun
         return false;
     }
 
-    s = *(T*)p;
-    p += szcb;
+    static_assert(std::is_trivially_copyable_v<T>, "Only primitive types can be read");
+    static_assert(!std::is_same_v<T, bool>, "Use read_aligned() overload for bool");
+
+    //INFO: 'p' may not be aligned for T - see copy_aligned()
+    memcpy(&s, p, sizeof(s));
+    p += aligned(sizeof(s));
+
+    return true;
+}
+
+
+
+/// <summary>
+/// Read boolean from memory, by checking for overruns
+/// </summary>
+/// <param name="p">Pointer to byte array to read from</param>
+/// <param name="pEnd">End of the byte array, exclusive</param>
+/// <param name="s">Boolean to set</param>
+/// <returns>true if success, false if failed</returns>
+inline bool read_aligned(const uint8_t*& p, const uint8_t* pEnd, bool& s)
+{
+    static_assert(sizeof(bool) == sizeof(uint8_t), "Unsupported size of bool");
+
+    uint8_t v;
+    if(!read_aligned(p, pEnd, v))
+    {
+        return false;
+    }
+
+    //Any other value can't be loaded into a bool
+    if(v > 1)
+    {
+        return false;
+    }
+
+    s = v != 0;
 
     return true;
 }
@@ -184,52 +251,857 @@ inline bool read_aligned_double(const uint8_t*& p, const uint8_t* pEnd, T& s)
 
 
 
+//Limits on resources used by a single de-serialization call, 0 for no limit
+struct DecodeLimits
+{
+    size_t szMaxStudents = 0;               //Maximum number of students
+    size_t szcbMaxStrings = 0;              //Maximum size of all strings copied out of the byte array, in bytes
+    size_t szcbMaxAllocations = 0;          //Maximum size of all memory allocations, in bytes (estimated)
+};
+
+
+
+//Resources used so far by a single de-serialization call
+struct DecodeBudget
+{
+    const DecodeLimits* pLimits = nullptr;  //Limits to enforce, or 0 if none
+
+    size_t szcbStrings = 0;                 //Size of all strings copied out so far, in bytes
+    size_t szcbAllocations = 0;             //Size of all memory allocations so far, in bytes
+
+
+    /// <summary>
+    /// Accounts for a memory allocation
+    /// </summary>
+    /// <param name="szcb">Size of allocation in bytes</param>
+    /// <returns>true if within the limits, false if not</returns>
+    bool addAllocation(size_t szcb)
+    {
+        if(pLimits &&
+            pLimits->szcbMaxAllocations > 0)
+        {
+            if(szcb > pLimits->szcbMaxAllocations - szcbAllocations)
+                return false;
+        }
+
+        szcbAllocations += szcb;
+
+        return true;
+    }
+
+
+    /// <summary>
+    /// Accounts for a string copied out of the byte array
+    /// </summary>
+    /// <param name="szcb">Size of string in bytes</param>
+    /// <returns>true if within the limits, false if not</returns>
+    bool addString(size_t szcb)
+    {
+        if(pLimits &&
+            pLimits->szcbMaxStrings > 0)
+        {
+            if(szcb > pLimits->szcbMaxStrings - szcbStrings)
+                return false;
+        }
+
+        //INFO: Short strings may be stored inside of std::string without allocating memory, but up to what
+        //      length depends on the STL (it's not sizeof(std::string)) - so count all of them
+        if(!addAllocation(szcb))
+            return false;
+
+        szcbStrings += szcb;
+
+        return true;
+    }
+};
+
+
+
 /// <summary>
 /// Read STL string from memory, by checking for overruns
 /// </summary>
 /// <param name="p">Pointer to byte array to read from</param>
 /// <param name="pEnd">End of the byte array, exclusive</param>
-/// <param name="s">STL string to set</param>
+/// <param name="s">STL string to set - the type of its characters is taken from it</param>
 /// <param name="szchMaxLen">if not 0, maximum allowed length of 's' in characters</param>
+/// <param name="pBudget">if not 0, resources used by this de-serialization call, to check and update</param>
 /// <returns>true if success, false if failed</returns>
 template<class T>
-inline bool read_aligned_str(const uint8_t*& p, const uint8_t* pEnd, T& s, size_t szchMaxLen)
+inline bool read_aligned_str(const uint8_t*& p, const uint8_t* pEnd, T& s, size_t szchMaxLen, DecodeBudget* pBudget = nullptr)
 {
     /*
     size_t length;
-    char[] str;
+    CH[] str;
     */
 
+    using CH = typename T::value_type;
+
     size_t sz;
     if(!read_aligned(p, pEnd, sz))
     {
         return false;
     }
 
-    if((intptr_t)sz < 0 ||
-        p + sz * sizeof(STR_CHAR) > pEnd)
+    if(!fits_aligned_array<CH>(p, pEnd, sz))
     {
         //Overrun
         return false;
     }
 
-    s.assign((const STR_CHAR*)p, sz);
-    p += aligned(sz * sizeof(STR_CHAR));
+    //Check limits before allocating memory for the string
+    if(szchMaxLen > 0)
+    {
+        if(sz > szchMaxLen)
+        {
+            return false;
+        }
+    }
+
+    if(pBudget)
+    {
+        if(!pBudget->addString(sz * sizeof(CH)))
+        {
+            return false;
+        }
+    }
+
+    if constexpr(sizeof(CH) == 1)
+    {
+        s.assign((const CH*)p, sz);
+    }
+    else
+    {
+        //Characters may be misaligned in the byte array
+        s.resize(sz);
+        memcpy(s.data(), p, sz * sizeof(CH));
+    }
+    p += aligned(sz * sizeof(CH));
+
+    return true;
+}
+
+
+
+/// <summary>
+/// Skip over STL string in memory without reading it, by checking for overruns
+/// </summary>
+/// <typeparam name="CH">Type of characters in the string</typeparam>
+/// <param name="p">Pointer to byte array to read from</param>
+/// <param name="pEnd">End of the byte array, exclusive</param>
+/// <param name="szchMaxLen">if not 0, maximum allowed length of the string in characters</param>
+/// <param name="pszchLen">if not 0, receives the length of the string in characters</param>
+/// <returns>true if success, false if failed</returns>
+template<class CH = char>
+inline bool skip_aligned_str(const uint8_t*& p, const uint8_t* pEnd, size_t szchMaxLen, size_t* pszchLen = nullptr)
+{
+    /*
+    size_t length;
+    CH[] str;
+    */
+
+    size_t sz;
+    if(!read_aligned(p, pEnd, sz))
+    {
+        return false;
+    }
 
     if(szchMaxLen > 0)
     {
-        if(s.size() > szchMaxLen)
+        if(sz > szchMaxLen)
         {
             return false;
         }
     }
 
+    if(!fits_aligned_array<CH>(p, pEnd, sz))
+    {
+        //Overrun
+        return false;
+    }
+
+    p += aligned(sz * sizeof(CH));
+
+    if(pszchLen)
+    {
+        *pszchLen = sz;
+    }
+
     return true;
 }
 
 
 
+//Reference to a std::string inside of a serialized byte array, to copy it out only when it's needed
+//INFO: The byte array must remain valid until the string is copied out!
+struct LazyStr
+{
+    const uint8_t* pChars = nullptr;        //Characters of the string in the byte array, or 0 if nothing is referenced
+    size_t szchLen = 0;                     //Length of the string in characters
+
+    bool isPending() const
+    {
+        return pChars != nullptr;
+    }
+
+    std::string_view view() const
+    {
+        return std::string_view((const char*)pChars, szchLen);
+    }
+};
+
+
+
+//String that owns its characters, or refers to them in a serialized byte array if it was de-serialized lazily.
+//Its value is kept in one place, so reading it always returns what was last set.
+//INFO: Copies always own their characters, so that they don't depend on the lifetime of the original byte array.
+class LazyOrOwnedStr
+{
+public:
+    LazyOrOwnedStr()
+    {
+    }
+
+    LazyOrOwnedStr(const LazyOrOwnedStr& other)
+        : _str(other.view())
+    {
+    }
+
+    LazyOrOwnedStr& operator=(const LazyOrOwnedStr& other)
+    {
+        if(this != &other)
+        {
+            set(other.view());
+        }
+
+        return *this;
+    }
+
+    LazyOrOwnedStr(LazyOrOwnedStr&&) = default;
+    LazyOrOwnedStr& operator=(LazyOrOwnedStr&&) = default;
+
+
+    /// <summary>
+    /// Returns true if the string still refers to the byte array
+    /// </summary>
+    bool isPending() const
+    {
+        return _lz.isPending();
+    }
+
+
+    /// <summary>
+    /// Returns the string, and copies it out of the byte array, if it was de-serialized lazily
+    /// </summary>
+    const std::string& get()
+    {
+        if(_lz.isPending())
+        {
+            _str.assign(_lz.view());
+            _lz = LazyStr();
+        }
+
+        return _str;
+    }
+
+
+    /// <summary>
+    /// Returns the string without copying it
+    /// </summary>
+    /// <returns>View of the string, valid until this object is modified</returns>
+    std::string_view view() const
+    {
+        return _lz.isPending() ? _lz.view() : std::string_view(_str);
+    }
+
+
+    /// <summary>
+    /// Sets the string, and drops the reference to the byte array
+    /// </summary>
+    void set(std::string_view s)
+    {
+        _str.assign(s);
+        _lz = LazyStr();
+    }
+
+
+    /// <summary>
+    /// Makes the string refer to characters in the byte array
+    /// </summary>
+    void setLazy(const LazyStr& lz)
+    {
+        _str.clear();
+        _lz = lz;
+    }
+
+
+    /// <summary>
+    /// Drops the reference to the byte array, and returns the owned string to write to
+    /// </summary>
+    std::string& owned()
+    {
+        _lz = LazyStr();
+
+        return _str;
+    }
+
+
+private:
+    std::string _str;                       //Owned characters, used if '_lz' is not pending
+    LazyStr _lz;                            //Reference to the characters in the byte array, if de-serialized lazily
+};
+
+
+
+/// <summary>
+/// Read STL string from memory as a reference, by checking for overruns. Characters are not copied.
+/// </summary>
+/// <param name="p">Pointer to byte array to read from</param>
+/// <param name="pEnd">End of the byte array, exclusive</param>
+/// <param name="s">Receives reference to the string in the byte array</param>
+/// <param name="szchMaxLen">if not 0, maximum allowed length of the string in characters</param>
+/// <returns>true if success, false if failed</returns>
+inline bool read_aligned_str_lazy(const uint8_t*& p, const uint8_t* pEnd, LazyStr& s, size_t szchMaxLen)
+{
+    const uint8_t* pStart = p;
+
+    size_t szchLen;
+    if(!skip_aligned_str<char>(p, pEnd, szchMaxLen, &szchLen))
+    {
+        return false;
+    }
+
+    s.pChars = pStart + aligned(sizeof(size_t));
+    s.szchLen = szchLen;
+
+    return true;
+}
+
+
+
+/// <summary>
+/// Calculates size of an array of primitive types taking alignment into account.
+/// The array is aligned as a whole, and not per element.
+/// </summary>
+/// <param name="szCnt">Number of elements in the array</param>
+/// <returns>Aligned size</returns>
+template<class T>
+inline size_t aligned_sizeof_array(size_t szCnt)
+{
+    return aligned(szCnt * sizeof(T));
+}
+
+
+
+/// <summary>
+/// Copy array of primitive types into a memory location
+/// </summary>
+/// <param name="p">Pointer to the memory location. It will be incremented by the aligned size of the array</param>
+/// <param name="pArr">Array to copy</param>
+/// <param name="szCnt">Number of elements in 'pArr'</param>
+template<class T>
+inline void copy_aligned_array(uint8_t*& p, const T* pArr, size_t szCnt)
+{
+    if(szCnt)
+    {
+        memcpy(p, pArr, szCnt * sizeof(T));
+    }
+
+    p += aligned_sizeof_array<T>(szCnt);
+}
+
+
+
+/// <summary>
+/// Locate array of primitive types in memory, by checking for overruns.
+/// Elements are not read, and 'pArr' may not be aligned for 'T' - use memcpy to read them.
+/// </summary>
+/// <param name="p">Pointer to byte array to read from</param>
+/// <param name="pEnd">End of the byte array, exclusive</param>
+/// <param name="szCnt">Number of elements in the array</param>
+/// <param name="pArr">Receives pointer to the first element of the array</param>
+/// <returns>true if success, false if failed</returns>
+template<class T>
+inline bool read_aligned_array_ptr(const uint8_t*& p, const uint8_t* pEnd, size_t szCnt, const uint8_t*& pArr)
+{
+    if(!fits_aligned_array<T>(p, pEnd, szCnt))
+    {
+        //Overrun
+        return false;
+    }
+
+    pArr = p;
+    p += aligned_sizeof_array<T>(szCnt);
+
+    return true;
+}
+
+
+
+//Validation hook that accepts any value - used by default by the helpers below
+struct accept_all
+{
+    template<class... ARGS>
+    bool operator()(const ARGS&...) const
+    {
+        return true;
+    }
+};
+
+
+
+//true if 'T' is an STL string, such as std::string or std::wstring
+template<class T>
+struct is_stl_string : std::false_type {};
+
+template<class CH, class TRAITS, class ALLOC>
+struct is_stl_string<std::basic_string<CH, TRAITS, ALLOC>> : std::true_type {};
+
+
+
+/// <summary>
+/// Checks raw elements of an array of primitive types before they are copied into it.
+/// Only bool has values that can't be loaded into it - anything besides 0 and 1.
+/// </summary>
+/// <param name="pArr">Pointer to the first element, as returned by read_aligned_array_ptr()</param>
+/// <param name="szCnt">Number of elements in 'pArr'</param>
+/// <returns>true if all elements can be copied, false if not</returns>
+template<class T>
+inline bool valid_raw_array(const uint8_t* pArr, size_t szCnt)
+{
+    if constexpr(std::is_same_v<T, bool>)
+    {
+        static_assert(sizeof(bool) == sizeof(uint8_t), "Unsupported size of bool");
+
+        for(size_t i = 0; i < szCnt; i++)
+        {
+            if(pArr[i] > 1)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
 
+/// <summary>
+/// Calculates size of std::vector of primitive types taking alignment into account
+/// </summary>
+/// <param name="v">Vector</param>
+/// <returns>Aligned size</returns>
+template<class T>
+inline size_t aligned_sizeof_vector(const std::vector<T>& v)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only vectors of primitive types are supported");
+
+    /*
+    size_t count;
+    T[] elements;
+    */
+
+    return aligned(sizeof(size_t)) +
+        aligned_sizeof_array<T>(v.size());
+}
+
+
+
+/// <summary>
+/// Copy std::vector of primitive types into a memory location, all elements at once
+/// </summary>
+/// <param name="p">Pointer to the memory location. It will be incremented by the sizeof vector</param>
+/// <param name="v">Vector to copy</param>
+template<class T>
+inline void copy_aligned_vector(uint8_t*& p, const std::vector<T>& v)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only vectors of primitive types are supported");
+
+    size_t szCnt = v.size();
+    copy_aligned(p, szCnt);
+
+    copy_aligned_array(p, v.data(), szCnt);
+}
+
+
+
+/// <summary>
+/// Read std::vector of primitive types from memory, all elements at once, by checking for overruns
+/// </summary>
+/// <param name="p">Pointer to byte array to read from</param>
+/// <param name="pEnd">End of the byte array, exclusive</param>
+/// <param name="v">Vector to set - it's not changed if this function fails</param>
+/// <param name="szMaxCnt">if not 0, maximum allowed number of elements</param>
+/// <param name="fnValidate">Callback to validate elements as: bool(const T* pElements, size_t szCnt), it should return false to fail</param>
+/// <returns>true if success, false if failed</returns>
+template<class T, class VALIDATE = accept_all>
+inline bool read_aligned_vector(const uint8_t*& p, const uint8_t* pEnd, std::vector<T>& v, size_t szMaxCnt = 0, VALIDATE fnValidate = VALIDATE())
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only vectors of primitive types are supported");
+    static_assert(!std::is_same_v<T, bool>, "std::vector<bool> doesn't store its elements as an array");
+
+    const uint8_t* pS = p;
+
+    size_t szCnt;
+    if(!read_aligned(pS, pEnd, szCnt))
+    {
+        return false;
+    }
+
+    if(szMaxCnt > 0 &&
+        szCnt > szMaxCnt)
+    {
+        return false;
+    }
+
+    //Single bounds check for all elements
+    const uint8_t* pArr;
+    if(!read_aligned_array_ptr<T>(pS, pEnd, szCnt, pArr))
+    {
+        return false;
+    }
+
+    std::vector<T> vRead(szCnt);
+
+    if(szCnt)
+    {
+        memcpy(vRead.data(), pArr, szCnt * sizeof(T));
+    }
+
+    if(!fnValidate((const T*)vRead.data(), szCnt))
+    {
+        return false;
+    }
+
+    v.swap(vRead);
+    p = pS;
+
+    return true;
+}
+
+
+
+/// <summary>
+/// Calculates size of std::optional of a primitive type taking alignment into account
+/// </summary>
+/// <param name="v">Optional value</param>
+/// <returns>Aligned size</returns>
+template<class T>
+inline size_t aligned_sizeof_optional(const std::optional<T>& v)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only optional primitive types are supported");
+
+    /*
+    uint8_t has_value;
+    [T value;]      <- only if has_value is 1
+    */
+
+    return aligned(sizeof(uint8_t)) +
+        (v.has_value() ? aligned(sizeof(T)) : 0);
+}
+
+
+
+/// <summary>
+/// Copy std::optional of a primitive type into a memory location
+/// </summary>
+/// <param name="p">Pointer to the memory location. It will be incremented by the sizeof optional value</param>
+/// <param name="v">Optional value to copy</param>
+template<class T>
+inline void copy_aligned_optional(uint8_t*& p, const std::optional<T>& v)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only optional primitive types are supported");
+
+    copy_aligned(p, (uint8_t)(v.has_value() ? 1 : 0));
+
+    if(v.has_value())
+    {
+        copy_aligned(p, *v);
+    }
+}
+
+
+
+/// <summary>
+/// Read std::optional of a primitive type from memory, by checking for overruns
+/// </summary>
+/// <param name="p">Pointer to byte array to read from</param>
+/// <param name="pEnd">End of the byte array, exclusive</param>
+/// <param name="v">Optional value to set - it's not changed if this function fails</param>
+/// <param name="fnValidate">Callback to validate the value, if it's present, as: bool(const T&amp; value), it should return false to fail</param>
+/// <returns>true if success, false if failed</returns>
+template<class T, class VALIDATE = accept_all>
+inline bool read_aligned_optional(const uint8_t*& p, const uint8_t* pEnd, std::optional<T>& v, VALIDATE fnValidate = VALIDATE())
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only optional primitive types are supported");
+
+    const uint8_t* pS = p;
+
+    uint8_t nHasValue;
+    if(!read_aligned(pS, pEnd, nHasValue))
+    {
+        return false;
+    }
+
+    if(nHasValue == 0)
+    {
+        v.reset();
+    }
+    else if(nHasValue == 1)
+    {
+        T val;
+        if(!read_aligned(pS, pEnd, val))
+        {
+            return false;
+        }
+
+        if(!fnValidate((const T&)val))
+        {
+            return false;
+        }
+
+        v = val;
+    }
+    else
+    {
+        //Bad flag
+        return false;
+    }
+
+    p = pS;
+
+    return true;
+}
+
+
+
+/// <summary>
+/// Copy std::array of primitive types into a memory location, all elements at once
+/// </summary>
+/// <param name="p">Pointer to the memory location. It will be incremented by the aligned size of the array</param>
+/// <param name="arr">Array to copy</param>
+template<class T, size_t N>
+inline void copy_aligned_std_array(uint8_t*& p, const std::array<T, N>& arr)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only arrays of primitive types are supported");
+
+    //INFO: The number of elements is known at compile time, so it's not stored
+    copy_aligned_array(p, arr.data(), N);
+}
+
+
+
+/// <summary>
+/// Read std::array of primitive types from memory, all elements at once, by checking for overruns
+/// </summary>
+/// <param name="p">Pointer to byte array to read from</param>
+/// <param name="pEnd">End of the byte array, exclusive</param>
+/// <param name="arr">Array to set - it's not changed if this function fails</param>
+/// <param name="fnValidate">Callback to validate elements as: bool(const T* pElements, size_t szCnt), it should return false to fail</param>
+/// <returns>true if success, false if failed</returns>
+template<class T, size_t N, class VALIDATE = accept_all>
+inline bool read_aligned_std_array(const uint8_t*& p, const uint8_t* pEnd, std::array<T, N>& arr, VALIDATE fnValidate = VALIDATE())
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Only arrays of primitive types are supported");
+
+    const uint8_t* pS = p;
+
+    const uint8_t* pArr;
+    if(!read_aligned_array_ptr<T>(pS, pEnd, N, pArr))
+    {
+        return false;
+    }
+
+    //Elements are copied with memcpy, so make sure that they are valid for 'T' first
+    if(!valid_raw_array<T>(pArr, N))
+    {
+        return false;
+    }
+
+    std::array<T, N> arrRead;
+    if(N)
+    {
+        memcpy(arrRead.data(), pArr, N * sizeof(T));
+    }
+
+    if(!fnValidate((const T*)arrRead.data(), N))
+    {
+        return false;
+    }
+
+    arr = arrRead;
+    p = pS;
+
+    return true;
+}
+
+
+
+//true if 'T' can be used as a key or value of std::map with the helpers below
+template<class T>
+inline constexpr bool is_map_item_v = std::is_arithmetic_v<T> || std::is_enum_v<T> || is_stl_string<T>::value;
+
+
+
+/// <summary>
+/// Calculates size of a key or value of std::map, that is either a primitive type or an STL string
+/// </summary>
+template<class T>
+inline size_t aligned_sizeof_item(const T& v)
+{
+    if constexpr(std::is_trivially_copyable_v<T>)
+        return aligned(sizeof(T));
+    else
+        return aligned_sizeof_str(v);
+}
+
+
+/// <summary>
+/// Copy a key or value of std::map, that is either a primitive type or an STL string, into a memory location
+/// </summary>
+template<class T>
+inline void copy_aligned_item(uint8_t*& p, const T& v)
+{
+    if constexpr(std::is_trivially_copyable_v<T>)
+        copy_aligned(p, v);
+    else
+        copy_aligned_str(p, v);
+}
+
+
+/// <summary>
+/// Read a key or value of std::map, that is either a primitive type or an STL string, by checking for overruns
+/// </summary>
+template<class T>
+inline bool read_aligned_item(const uint8_t*& p, const uint8_t* pEnd, T& v, size_t szchMaxLen)
+{
+    if constexpr(std::is_trivially_copyable_v<T>)
+        return read_aligned(p, pEnd, v);
+    else
+        return read_aligned_str(p, pEnd, v, szchMaxLen);
+}
+
+
+
+/// <summary>
+/// Calculates size of std::map taking alignment into account
+/// </summary>
+/// <param name="m">Map, its keys and values must be primitive types or STL strings</param>
+/// <returns>Aligned size</returns>
+template<class K, class V>
+inline size_t aligned_sizeof_map(const std::map<K, V>& m)
+{
+    static_assert(is_map_item_v<K> && is_map_item_v<V>, "Only maps of primitive types and STL strings are supported");
+
+    /*
+    size_t count;
+    {K key; V value;}[] elements;     <- sorted by 'key'
+    */
+
+    size_t szcb = aligned(sizeof(size_t));
+
+    for(const auto& kv : m)
+    {
+        szcb += aligned_sizeof_item(kv.first) + aligned_sizeof_item(kv.second);
+    }
+
+    return szcb;
+}
+
+
+
+/// <summary>
+/// Copy std::map into a memory location
+/// </summary>
+/// <param name="p">Pointer to the memory location. It will be incremented by the sizeof map</param>
+/// <param name="m">Map to copy, its keys and values must be primitive types or STL strings</param>
+template<class K, class V>
+inline void copy_aligned_map(uint8_t*& p, const std::map<K, V>& m)
+{
+    static_assert(is_map_item_v<K> && is_map_item_v<V>, "Only maps of primitive types and STL strings are supported");
+
+    size_t szCnt = m.size();
+    copy_aligned(p, szCnt);
+
+    for(const auto& kv : m)
+    {
+        copy_aligned_item(p, kv.first);
+        copy_aligned_item(p, kv.second);
+    }
+}
+
+
+
+/// <summary>
+/// Read std::map from memory, by checking for overruns. Keys must be stored in ascending order, without duplicates.
+/// </summary>
+/// <param name="p">Pointer to byte array to read from</param>
+/// <param name="pEnd">End of the byte array, exclusive</param>
+/// <param name="m">Map to set, its keys and values must be primitive types or STL strings - it's not changed if this function fails</param>
+/// <param name="szMaxCnt">if not 0, maximum allowed number of elements</param>
+/// <param name="szchMaxLen">if not 0, maximum allowed length of keys and values that are strings, in characters</param>
+/// <param name="fnValidate">Callback to validate each element as: bool(const K&amp; key, const V&amp; value), it should return false to fail</param>
+/// <returns>true if success, false if failed</returns>
+template<class K, class V, class VALIDATE = accept_all>
+inline bool read_aligned_map(const uint8_t*& p, const uint8_t* pEnd, std::map<K, V>& m, size_t szMaxCnt = 0, size_t szchMaxLen = 0, VALIDATE fnValidate = VALIDATE())
+{
+    static_assert(is_map_item_v<K> && is_map_item_v<V>, "Only maps of primitive types and STL strings are supported");
+
+    const uint8_t* pS = p;
+
+    size_t szCnt;
+    if(!read_aligned(pS, pEnd, szCnt))
+    {
+        return false;
+    }
+
+    if(szMaxCnt > 0 &&
+        szCnt > szMaxCnt)
+    {
+        return false;
+    }
+
+    //Each element takes at least this much, so the count can't be more than what fits in what's left
+    size_t szcbMinElement = 
+        (std::is_trivially_copyable_v<K> ? aligned(sizeof(K)) : aligned(sizeof(size_t))) +
+        (std::is_trivially_copyable_v<V> ? aligned(sizeof(V)) : aligned(sizeof(size_t)));
+
+    if(szCnt > (size_t)(pEnd - pS) / szcbMinElement)
+    {
+        return false;
+    }
+
+    std::map<K, V> mRead;
+
+    for(size_t i = 0; i < szCnt; i++)
+    {
+        K key;
+        V val;
+
+        if(!read_aligned_item(pS, pEnd, key, szchMaxLen) ||
+            !read_aligned_item(pS, pEnd, val, szchMaxLen))
+        {
+            return false;
+        }
+
+        //Keys must be in ascending order - this also rejects duplicates
+        if(!mRead.empty() &&
+            !(mRead.rbegin()->first < key))
+        {
+            return false;
+        }
+
+        if(!fnValidate((const K&)key, (const V&)val))
+        {
+            return false;
+        }
+
+        mRead.emplace_hint(mRead.end(), std::move(key), std::move(val));
+    }
+
+    m.swap(mRead);
+    p = pS;
+
+    return true;
+}
 
 
 
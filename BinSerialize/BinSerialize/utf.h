@@ -0,0 +1,274 @@
+// This is a Proof-of-Concept (POC) project that demonstrates
+// secure coding practices when programming binary
+// serialization & de-serialization in C++.
+//
+// Copyright (c) 2023, by dennisbabkin.com
+//
+//
+// This project is used in the following blog post:
+//
+//  "Secure Programming Practices - Serialization"
+//  "Example of secure binary serialization and de-serialization in C++."
+//
+//   https://dennisbabkin.com/blog/?i=AAA12200
+//
+
+
+//Conversion between UTF-16 and UTF-8, with a vectorized path for ASCII characters
+//
+#pragma once
+
+#include <string>
+
+#include "types.h"
+#include "simd.h"
+
+
+
+
+/// <summary>
+/// Converts UTF-16 characters to UTF-8
+/// </summary>
+/// <param name="pChars">UTF-16 characters, may be unaligned</param>
+/// <param name="szchLen">Number of UTF-16 code units in 'pChars'</param>
+/// <param name="s">Receives UTF-8 string</param>
+/// <returns>true if success, false if 'pChars' has a lone surrogate</returns>
+inline bool utf16_to_utf8(const void* pChars, size_t szchLen, std::string& s)
+{
+    const uint8_t* p = (const uint8_t*)pChars;
+
+    s.clear();
+
+    //Each UTF-16 code unit becomes at most 3 bytes of UTF-8 (a surrogate pair becomes 4)
+    s.resize(szchLen * 3);
+
+    char* pD = s.data();
+
+    size_t i = 0;
+    while(i < szchLen)
+    {
+#ifdef SIMD_SSE2
+        //Convert 8 ASCII characters at once
+        if(i + 8 <= szchLen)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + i * sizeof(char16_t)));
+
+            if(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xFF80)), _mm_setzero_si128())) == 0xFFFF)
+            {
+                _mm_storel_epi64((__m128i*)pD, _mm_packus_epi16(v, v));
+                pD += 8;
+                i += 8;
+
+                continue;
+            }
+        }
+#endif
+
+        char16_t c;
+        memcpy(&c, p + i * sizeof(c), sizeof(c));
+        i++;
+
+        if(c < 0x80)
+        {
+            *pD++ = (char)c;
+        }
+        else if(c < 0x800)
+        {
+            *pD++ = (char)(0xC0 | (c >> 6));
+            *pD++ = (char)(0x80 | (c & 0x3F));
+        }
+        else if(c < 0xD800 || c > 0xDFFF)
+        {
+            *pD++ = (char)(0xE0 | (c >> 12));
+            *pD++ = (char)(0x80 | ((c >> 6) & 0x3F));
+            *pD++ = (char)(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            //Surrogate pair - must be high followed by low
+            if(c > 0xDBFF ||
+                i >= szchLen)
+                return false;
+
+            char16_t c2;
+            memcpy(&c2, p + i * sizeof(c2), sizeof(c2));
+
+            if(c2 < 0xDC00 || c2 > 0xDFFF)
+                return false;
+
+            i++;
+
+            uint32_t cp = 0x10000 + (((uint32_t)c - 0xD800) << 10) + ((uint32_t)c2 - 0xDC00);
+
+            *pD++ = (char)(0xF0 | (cp >> 18));
+            *pD++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+            *pD++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+            *pD++ = (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    s.resize(pD - s.data());
+
+    return true;
+}
+
+
+
+/// <summary>
+/// Converts UTF-8 characters to UTF-16
+/// </summary>
+/// <param name="pChars">UTF-8 characters</param>
+/// <param name="szcbLen">Number of bytes in 'pChars'</param>
+/// <param name="s">Receives UTF-16 string</param>
+/// <returns>true if success, false if 'pChars' is not valid UTF-8</returns>
+inline bool utf8_to_utf16(const void* pChars, size_t szcbLen, std::u16string& s)
+{
+    const uint8_t* p = (const uint8_t*)pChars;
+
+    s.clear();
+
+    //Each byte of UTF-8 becomes at most one UTF-16 code unit
+    s.resize(szcbLen);
+
+    char16_t* pD = s.data();
+
+    size_t i = 0;
+    while(i < szcbLen)
+    {
+#ifdef SIMD_SSE2
+        //Convert 16 ASCII characters at once
+        if(i + 16 <= szcbLen)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+
+            if(_mm_movemask_epi8(v) == 0)
+            {
+                _mm_storeu_si128((__m128i*)pD, _mm_unpacklo_epi8(v, _mm_setzero_si128()));
+                _mm_storeu_si128((__m128i*)(pD + 8), _mm_unpackhi_epi8(v, _mm_setzero_si128()));
+                pD += 16;
+                i += 16;
+
+                continue;
+            }
+        }
+#endif
+
+        uint32_t c = p[i++];
+
+        if(c < 0x80)
+        {
+            *pD++ = (char16_t)c;
+
+            continue;
+        }
+
+        //Number of continuation bytes, and smallest code point for it to not be overlong
+        size_t szcbMore;
+        uint32_t cpMin;
+
+        if((c & 0xE0) == 0xC0)
+        {
+            szcbMore = 1;
+            cpMin = 0x80;
+            c &= 0x1F;
+        }
+        else if((c & 0xF0) == 0xE0)
+        {
+            szcbMore = 2;
+            cpMin = 0x800;
+            c &= 0x0F;
+        }
+        else if((c & 0xF8) == 0xF0)
+        {
+            szcbMore = 3;
+            cpMin = 0x10000;
+            c &= 0x07;
+        }
+        else
+        {
+            //Bad leading byte
+            return false;
+        }
+
+        if(szcbMore > szcbLen - i)
+            return false;
+
+        for(size_t k = 0; k < szcbMore; k++)
+        {
+            uint8_t b = p[i++];
+            if((b & 0xC0) != 0x80)
+                return false;
+
+            c = (c << 6) | (b & 0x3F);
+        }
+
+        if(c < cpMin ||
+            c > 0x10FFFF ||
+            (c >= 0xD800 && c <= 0xDFFF))
+        {
+            //Overlong, out of range, or a surrogate
+            return false;
+        }
+
+        if(c < 0x10000)
+        {
+            *pD++ = (char16_t)c;
+        }
+        else
+        {
+            c -= 0x10000;
+            *pD++ = (char16_t)(0xD800 + (c >> 10));
+            *pD++ = (char16_t)(0xDC00 + (c & 0x3FF));
+        }
+    }
+
+    s.resize(pD - s.data());
+
+    return true;
+}
+
+
+
+/// <summary>
+/// Read UTF-16 string from memory (as written by copy_aligned_str() for std::u16string) directly into a UTF-8 string,
+/// by checking for overruns
+/// </summary>
+/// <param name="p">Pointer to byte array to read from</param>
+/// <param name="pEnd">End of the byte array, exclusive</param>
+/// <param name="s">UTF-8 string to set</param>
+/// <param name="szchMaxLen">if not 0, maximum allowed length of the string in UTF-16 code units</param>
+/// <param name="pBudget">if not 0, resources used by this de-serialization call, to check and update.
+///                       The string is counted at 3 bytes per UTF-16 code unit, since that's how much is allocated for it</param>
+/// <returns>true if success, false if failed</returns>
+inline bool read_aligned_str_utf16_as_utf8(const uint8_t*& p, const uint8_t* pEnd, std::string& s, size_t szchMaxLen, DecodeBudget* pBudget = nullptr)
+{
+    const uint8_t* pS = p;
+
+    size_t szchLen;
+    if(!skip_aligned_str<char16_t>(pS, pEnd, szchMaxLen, &szchLen))
+    {
+        return false;
+    }
+
+    //INFO: Can't overflow since 'szchLen' UTF-16 code units fit in the byte array
+    if(pBudget)
+    {
+        if(!pBudget->addString(szchLen * 3))
+        {
+            return false;
+        }
+    }
+
+    if(!utf16_to_utf8(p + aligned(sizeof(size_t)), szchLen, s))
+    {
+        return false;
+    }
+
+    p = pS;
+
+    return true;
+}
+
+
+
+